@@ -0,0 +1,280 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "frame_arena.h"
+#include "gl_state.h"
+#include "instances.h"
+#include "multi_draw.h"
+#include "types.h"
+
+enum RenderPass : u32 {
+    PASS_OPAQUE,
+    PASS_TRANSPARENT,
+    PASS_OVERLAY,
+};
+
+// 64-bit draw sort key, most significant field first, so sorting the keys
+// groups draws by pass, then program, then material, then depth:
+//
+//   63     56 55        44 43            24 23              0
+//   | pass   | program    | material      | depth           |
+//
+// Opaque draws want a front-to-back depth and transparent ones back-to-
+// front; the caller quantizes accordingly (see quantizeDepth()).
+constexpr u32 SORT_KEY_PASS_BITS = 8;
+constexpr u32 SORT_KEY_PROGRAM_BITS = 12;
+constexpr u32 SORT_KEY_MATERIAL_BITS = 20;
+constexpr u32 SORT_KEY_DEPTH_BITS = 24;
+
+constexpr u32 SORT_KEY_DEPTH_SHIFT = 0;
+constexpr u32 SORT_KEY_MATERIAL_SHIFT = SORT_KEY_DEPTH_BITS;
+constexpr u32 SORT_KEY_PROGRAM_SHIFT =
+    SORT_KEY_MATERIAL_SHIFT + SORT_KEY_MATERIAL_BITS;
+constexpr u32 SORT_KEY_PASS_SHIFT =
+    SORT_KEY_PROGRAM_SHIFT + SORT_KEY_PROGRAM_BITS;
+
+constexpr u64 sortKeyField(u64 value, u32 bits, u32 shift) {
+    return (value & ((1ull << bits) - 1)) << shift;
+}
+
+constexpr u64 makeSortKey(u32 pass, u32 program, u32 material, u32 depth) {
+    return sortKeyField(pass, SORT_KEY_PASS_BITS, SORT_KEY_PASS_SHIFT) |
+           sortKeyField(program, SORT_KEY_PROGRAM_BITS,
+                        SORT_KEY_PROGRAM_SHIFT) |
+           sortKeyField(material, SORT_KEY_MATERIAL_BITS,
+                        SORT_KEY_MATERIAL_SHIFT) |
+           sortKeyField(depth, SORT_KEY_DEPTH_BITS, SORT_KEY_DEPTH_SHIFT);
+}
+
+// Maps a depth in [0, 1] to the key's depth field; `reverse` sorts far
+// draws first.
+inline u32 quantizeDepth(f32 depth, bool reverse) {
+    constexpr f32 MAX_DEPTH = (f32)((1u << SORT_KEY_DEPTH_BITS) - 1);
+    const f32 clamped = SDL_clamp(depth, 0.0f, 1.0f);
+    return (u32)((reverse ? 1.0f - clamped : clamped) * MAX_DEPTH);
+}
+
+enum DrawKind : u32 {
+    DRAW_ARRAYS,               // glDrawArrays, or instanced
+    DRAW_ARRAYS_INDIRECT,      // glDrawArraysIndirect from `indirect`
+    DRAW_MULTI_INDIRECT,       // MultiDrawIndirect::draw() over `instances`
+    DRAW_MULTI_INDIRECT_COUNT, // the same, with the count read on the GPU
+};
+
+// Everything needed to issue one draw. Instanced and indirect draws read
+// their instances from `instances` at `instance_offset`, which is bound to
+// binding 0 of the vertex array (or, for multi-draw, as the per-draw storage
+// buffer); 0 leaves the binding as it is. A plain glDrawArrays takes the
+// constant values of attributes 1 and 2 from `instance` instead; the
+// material field of the sort key identifies its color, which is only set
+// again when it changes.
+struct DrawCommand {
+    GLuint program;
+    GLuint vertex_array;
+    GLenum mode;
+    DrawKind kind;
+    GLint first;
+    GLsizei vertex_count;
+    GLsizei instance_count; // 0 for a plain glDrawArrays; draws, for multi
+    GLuint instances;
+    GLintptr instance_offset;
+    GLuint indirect; // the DrawArraysIndirectCommand buffer
+    Instance instance;
+};
+
+// Render code submits keyed draws in any order; sort() puts them in key
+// order with an LSD radix sort and dispatch() issues them in one pass through
+// the state cache. Keys and payloads live in the frame arena: reset() starts
+// a new list in the current frame, and a dispatched list stays valid until
+// its region comes round again, so frames never touch the heap.
+struct CommandQueue {
+    static constexpr u32 MIN_CAPACITY = 16;
+
+    struct Entry {
+        u64 key;
+        u32 command;
+    };
+
+    FrameArena* arena = nullptr;
+    Entry* entries = nullptr;
+    DrawCommand* commands = nullptr;
+    u32 count = 0;
+    u32 capacity = 0;
+
+    // Of the last dispatch().
+    u32 program_changes = 0;
+    u32 material_changes = 0;
+
+    void initialize(FrameArena* frame_arena) {
+        arena = frame_arena;
+        reset();
+    }
+
+    void reset() {
+        entries = nullptr;
+        commands = nullptr;
+        count = capacity = 0;
+    }
+
+    // Adds a draw with `key` and returns its payload to fill in, or nullptr
+    // when out of memory.
+    DrawCommand* submit(u64 key) {
+        if (count == capacity && !grow()) {
+            return nullptr;
+        }
+
+        entries[count] = {key, count};
+        return &commands[count++];
+    }
+
+    // Keys and payloads take turns at the end of the arena, so growing
+    // copies them; doubling keeps that linear in the draw count.
+    bool grow() {
+        const u32 new_capacity = SDL_max(capacity * 2, MIN_CAPACITY);
+        const auto new_entries = (Entry*)arena->reallocate(
+            entries, sizeof(Entry) * capacity, sizeof(Entry) * new_capacity,
+            alignof(Entry)
+        );
+        const auto new_commands = (DrawCommand*)arena->reallocate(
+            commands, sizeof(DrawCommand) * capacity,
+            sizeof(DrawCommand) * new_capacity, alignof(DrawCommand)
+        );
+        if (!new_entries || !new_commands) {
+            SDL_Log("Failed to grow the command queue to %u draws",
+                    new_capacity);
+            return false;
+        }
+
+        entries = new_entries;
+        commands = new_commands;
+        capacity = new_capacity;
+        return true;
+    }
+
+    // Stable LSD radix sort on 8-bit digits. All eight histograms come from
+    // one read of the keys, and digits that are the same for every key (the
+    // unused high pass bits, say) are skipped.
+    void sort() {
+        constexpr u32 DIGITS = 8;
+        if (count < 2) {
+            return;
+        }
+
+        Entry* scratch = arena->allocateArray<Entry>(count);
+        if (!scratch) {
+            SDL_Log("Failed to sort %u draws, dispatching them unsorted",
+                    count);
+            return;
+        }
+
+        u32 histograms[DIGITS][256] = {};
+
+        for (u32 i = 0; i < count; i++) {
+            const u64 key = entries[i].key;
+            for (u32 d = 0; d < DIGITS; d++) {
+                histograms[d][(key >> (d * 8)) & 0xFF]++;
+            }
+        }
+
+        for (u32 d = 0; d < DIGITS; d++) {
+            u32* histogram = histograms[d];
+            const u32 first_digit = (entries[0].key >> (d * 8)) & 0xFF;
+            if (histogram[first_digit] == count) {
+                continue;
+            }
+
+            u32 offset = 0;
+            for (u32 bucket = 0; bucket < 256; bucket++) {
+                const u32 bucket_count = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucket_count;
+            }
+
+            for (u32 i = 0; i < count; i++) {
+                const u32 digit = (entries[i].key >> (d * 8)) & 0xFF;
+                scratch[histogram[digit]++] = entries[i];
+            }
+
+            Entry* sorted = scratch;
+            scratch = entries;
+            entries = sorted;
+        }
+
+        // The keys may now be in the scratch array, which only holds
+        // `count`; a later submit() copies them out.
+        capacity = count;
+    }
+
+    // Issues the draws in their current order. Attribute 0 (the global
+    // offset), uniforms and the buffers compute passes left bound are the
+    // caller's. `multi_draw` is only needed for the multi-draw kinds.
+    void dispatch(GLStateCache* state, MultiDrawIndirect* multi_draw) {
+        constexpr u64 MATERIAL_MASK = sortKeyField(
+            ~0ull, SORT_KEY_MATERIAL_BITS, SORT_KEY_MATERIAL_SHIFT
+        );
+
+        program_changes = 0;
+        material_changes = 0;
+        GLuint program = 0;
+        u64 material = ~0ull;
+
+        for (u32 i = 0; i < count; i++) {
+            const DrawCommand& command = commands[entries[i].command];
+
+            if (command.program != program) {
+                program = command.program;
+                program_changes++;
+                state->useProgram(program);
+            }
+            state->bindVertexArray(command.vertex_array);
+
+            const bool multi = command.kind == DRAW_MULTI_INDIRECT ||
+                               command.kind == DRAW_MULTI_INDIRECT_COUNT;
+            if (command.instances && !multi) {
+                glVertexArrayVertexBuffer(command.vertex_array, 0,
+                                          command.instances,
+                                          command.instance_offset,
+                                          sizeof(Instance));
+            }
+
+            switch (command.kind) {
+            case DRAW_ARRAYS:
+                if (command.instance_count > 0) {
+                    glDrawArraysInstanced(command.mode, command.first,
+                                          command.vertex_count,
+                                          command.instance_count);
+                    break;
+                }
+
+                if (const u64 key_material = entries[i].key & MATERIAL_MASK;
+                    key_material != material) {
+                    material = key_material;
+                    material_changes++;
+                    glVertexAttrib4fv(1, command.instance.color);
+                }
+                glVertexAttrib4fv(2, command.instance.offset_scale);
+                glDrawArrays(command.mode, command.first,
+                             command.vertex_count);
+                break;
+            case DRAW_ARRAYS_INDIRECT:
+                state->bindBuffer(GL_DRAW_INDIRECT_BUFFER, command.indirect);
+                glDrawArraysIndirect(command.mode, nullptr);
+                break;
+            case DRAW_MULTI_INDIRECT:
+            case DRAW_MULTI_INDIRECT_COUNT:
+                multi_draw->draw(command.mode, command.instances,
+                                 command.instance_offset,
+                                 sizeof(Instance) * command.instance_count,
+                                 command.kind == DRAW_MULTI_INDIRECT_COUNT);
+                break;
+            }
+        }
+    }
+
+    void shutdown() {
+        reset();
+        arena = nullptr;
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "command_queue.h"
+#include "gl_state.h"
+#include "instances.h"
+#include "multi_draw.h"
+#include "types.h"
+
+// The compute replacement for the geometry-shader point expansion:
+// expand_compute.glsl turns every triangle into three points in an SSBO,
+// at slots fixed by the triangle's index so the output is deterministic, and
+// point_vertex.glsl draws them with glDrawArraysIndirect. The command is
+// kept in a buffer so that a pass emitting a varying number of points could
+// count them on the GPU.
+struct ComputeExpansion {
+    struct Point {
+        f32 position[4];
+        f32 color[4];
+    };
+
+    GLStateCache* state = nullptr;
+    GLuint expand_program = 0;
+    GLuint draw_program = 0;
+    GLint offset_location = -1;
+    GLint triangle_count_location = -1;
+    GLuint default_instance = 0;
+    GLuint points = 0;
+    GLuint command = 0;
+    u32 capacity = 0; // in triangles
+
+    // Takes ownership of both programs.
+    bool initialize(GLStateCache* gl_state, GLuint expand, GLuint draw) {
+        if (!expand || !draw) {
+            glDeleteProgram(expand);
+            glDeleteProgram(draw);
+            return false;
+        }
+
+        state = gl_state;
+        expand_program = expand;
+        draw_program = draw;
+        offset_location = glGetUniformLocation(expand, "offset");
+        triangle_count_location = glGetUniformLocation(expand,
+                                                       "triangle_count");
+
+        // Source for the single, non-instanced triangle.
+        glCreateBuffers(1, &default_instance);
+        glNamedBufferStorage(default_instance, sizeof(DEFAULT_INSTANCE),
+                             &DEFAULT_INSTANCE, 0);
+
+        const DrawArraysIndirectCommand initial = {0, 1, 0, 0};
+        glCreateBuffers(1, &command);
+        glNamedBufferStorage(command, sizeof(initial), &initial,
+                             GL_DYNAMIC_STORAGE_BIT);
+
+        return true;
+    }
+
+    void reserve(u32 triangle_count) {
+        if (triangle_count <= capacity) {
+            return;
+        }
+
+        capacity = SDL_max(triangle_count, capacity * 2);
+        state->deleteBuffer(&points);
+        glCreateBuffers(1, &points);
+        glNamedBufferStorage(points, sizeof(Point) * 3 * capacity, nullptr, 0);
+    }
+
+    // Expands `triangle_count` instances read from `source` at
+    // `source_offset`, or the single default triangle when `source` is 0.
+    void expand(
+        GLuint source,
+        GLintptr source_offset,
+        u32 triangle_count,
+        const f32* offset
+    ) {
+        if (!source) {
+            source = default_instance;
+            source_offset = 0;
+            triangle_count = 1;
+        }
+        reserve(triangle_count);
+
+        const GLuint count = triangle_count * 3;
+        glNamedBufferSubData(command, 0, sizeof(count), &count);
+
+        state->useProgram(expand_program);
+        glProgramUniform4fv(expand_program, offset_location, 1, offset);
+        glProgramUniform1ui(expand_program, triangle_count_location,
+                            triangle_count);
+        state->bindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, source,
+                               source_offset,
+                               sizeof(Instance) * triangle_count);
+        state->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, points);
+        glDispatchCompute((triangle_count + 63) / 64, 1, 1);
+
+        // point_vertex.glsl reads the points as an SSBO.
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // The draw of the last expand()'s points. point_vertex.glsl pulls them
+    // from the SSBO, so `vertex_array` needs no attributes.
+    DrawCommand drawCommand(GLuint vertex_array) const {
+        DrawCommand draw = {};
+        draw.program = draw_program;
+        draw.vertex_array = vertex_array;
+        draw.mode = GL_POINTS;
+        draw.kind = DRAW_ARRAYS_INDIRECT;
+        draw.indirect = command;
+        return draw;
+    }
+
+    void shutdown() {
+        if (!state) {
+            return;
+        }
+
+        glDeleteProgram(expand_program);
+        glDeleteProgram(draw_program);
+        state->deleteBuffer(&default_instance);
+        state->deleteBuffer(&points);
+        state->deleteBuffer(&command);
+        expand_program = draw_program = 0;
+        capacity = 0;
+        state = nullptr;
+    }
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <type_traits>
+
+#include "types.h"
+
+// Linear allocator for data that only lives for a frame: draw lists,
+// uniforms, culling results. Allocating bumps an offset and nothing is freed
+// on its own; endFrame() drops a whole frame's allocations by resetting that
+// offset. There is one region per frame in flight, like StreamBuffer, so what
+// a frame handed off stays valid until its region comes round again,
+// FRAMES - 1 frames later.
+//
+// A region that runs out chains an overflow block from the heap. The next
+// time the region is reset its blocks are folded into one of their combined
+// size, so once a frame of the largest size has been through, frames no
+// longer touch the heap. Nothing runs destructors, so only trivially
+// destructible types go in. Not thread-safe.
+struct FrameArena {
+    static constexpr u32 FRAMES = 3;
+    static constexpr usize DEFAULT_ALIGNMENT = 16;
+
+    // Header of a block; its data follows, cache-line aligned.
+    struct alignas(64) Block {
+        Block* next;
+        usize size;
+
+        u8* data() { return (u8*)(this + 1); }
+    };
+
+    struct Region {
+        Block* first;
+        Block* current;
+        usize used; // of current
+    };
+
+    Region regions[FRAMES] = {};
+    u32 region = 0;
+    usize block_size = 0;
+
+    // Of the frame being built.
+    u64 frame_allocations = 0;
+    usize frame_bytes = 0;
+
+    u64 frames = 0;
+    u64 allocations = 0; // of the frames before
+    usize bytes = 0;
+    usize peak_bytes = 0; // of one frame
+    u64 overflow_blocks = 0;
+
+    bool initialize(usize size) {
+        shutdown();
+
+        block_size = size;
+        for (auto& each : regions) {
+            each.first = each.current = createBlock(size);
+            if (!each.first) {
+                shutdown();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static Block* createBlock(usize size) {
+        const auto block =
+            (Block*)SDL_aligned_alloc(alignof(Block), sizeof(Block) + size);
+        if (!block) {
+            SDL_Log("Failed to allocate a %zu byte frame arena block", size);
+            return nullptr;
+        }
+        block->next = nullptr;
+        block->size = size;
+        return block;
+    }
+
+    static usize alignUp(usize value, usize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // `size` bytes aligned to `alignment` (a power of two, at most 64),
+    // valid for this frame and the FRAMES - 1 after it. Returns nullptr when
+    // out of memory.
+    void* allocate(usize size, usize alignment = DEFAULT_ALIGNMENT) {
+        Region& current = regions[region];
+        usize start = alignUp(current.used, alignment);
+        if (!current.current || start + size > current.current->size) {
+            if (!overflow(current, size + alignment)) {
+                return nullptr;
+            }
+            start = alignUp(current.used, alignment);
+        }
+
+        current.used = start + size;
+        frame_allocations++;
+        frame_bytes += size;
+        return current.current->data() + start;
+    }
+
+    // Chains a block of at least `size` bytes to the region.
+    bool overflow(Region& current, usize size) {
+        Block* block = createBlock(SDL_max(size, block_size));
+        if (!block) {
+            return false;
+        }
+
+        if (current.current) {
+            current.current->next = block;
+        } else {
+            current.first = block;
+        }
+        current.current = block;
+        current.used = 0;
+        overflow_blocks++;
+        return true;
+    }
+
+    // Grows the allocation at `pointer` from `old_size` to `new_size`
+    // bytes: in place when it is the last one made, by copying otherwise.
+    // The old memory stays valid either way, and is simply not reused.
+    void* reallocate(
+        void* pointer,
+        usize old_size,
+        usize new_size,
+        usize alignment = DEFAULT_ALIGNMENT
+    ) {
+        Region& current = regions[region];
+        if (pointer && current.current &&
+            (u8*)pointer + old_size ==
+                current.current->data() + current.used &&
+            (u8*)pointer - current.current->data() + new_size <=
+                current.current->size) {
+            current.used += new_size - old_size;
+            frame_bytes += new_size - old_size;
+            return pointer;
+        }
+
+        void* moved = allocate(new_size, alignment);
+        if (moved && pointer) {
+            SDL_memcpy(moved, pointer, old_size);
+        }
+        return moved;
+    }
+
+    template <typename T>
+    T* allocateArray(usize count) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "the arena never runs destructors");
+        return (T*)allocate(sizeof(T) * count, alignof(T));
+    }
+
+    // Moves on to the next region and frees what it held, FRAMES frames ago.
+    void endFrame() {
+        allocations += frame_allocations;
+        bytes += frame_bytes;
+        peak_bytes = SDL_max(peak_bytes, frame_bytes);
+        frame_allocations = 0;
+        frame_bytes = 0;
+        frames++;
+
+        region = (region + 1) % FRAMES;
+        resetRegion(regions[region]);
+    }
+
+    void resetRegion(Region& next) {
+        if (next.first && next.first->next) {
+            // It overflowed: make one block that would have held it all.
+            usize total = 0;
+            for (Block* block = next.first; block;) {
+                Block* following = block->next;
+                total += block->size;
+                SDL_aligned_free(block);
+                block = following;
+            }
+            next.first = createBlock(total);
+        }
+
+        next.current = next.first;
+        next.used = 0;
+    }
+
+    void logTotals() const {
+        const f64 per_frame = frames ? 1.0 / frames : 0.0;
+        SDL_Log("Frame arena: %.1f allocations and %.1f KiB per frame, peak "
+                "%.1f KiB, %llu overflow blocks",
+                allocations * per_frame, bytes * per_frame / 1024.0,
+                peak_bytes / 1024.0, (unsigned long long)overflow_blocks);
+    }
+
+    void shutdown() {
+        for (auto& each : regions) {
+            for (Block* block = each.first; block;) {
+                Block* following = block->next;
+                SDL_aligned_free(block);
+                block = following;
+            }
+            each = {};
+        }
+        region = 0;
+    }
+};
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+#include "gl_state.h"
+#include "image_io.h"
+#include "spsc_ring.h"
+#include "types.h"
+
+// Streams rendered frames to disk without stalling the frame loop. Each
+// captured frame is read into one of a ring of pixel-pack buffers and
+// fenced; glReadPixels into a buffer object returns immediately. Frames
+// whose fence has signalled are handed, in order, to a writer thread that
+// encodes straight out of the persistent mapping, so the pixels are never
+// copied on the CPU. The render thread only blocks when every slot is still
+// in use, which is counted as a stall.
+//
+// A path ending in .y4m records one raw 4:4:4 Y4M stream. Any other path is
+// a PPM per frame, used as a printf pattern for the frame number when it
+// contains a '%' (e.g. "frame_%05llu.ppm"). Such a pattern must have exactly
+// one %llu or %lld conversion, with an optional width, and may use %% for a
+// literal '%'.
+struct FrameCapture {
+    static constexpr u32 SLOTS = 4;
+
+    enum SlotState : u32 {
+        SLOT_FREE,
+        SLOT_READING, // glReadPixels issued, fence not yet signalled
+        SLOT_WRITING, // owned by the writer thread
+    };
+
+    struct Slot {
+        GLuint buffer = 0;
+        const u8* pixels = nullptr;
+        GLsync fence = nullptr;
+        u64 frame = 0;
+        std::atomic<u32> state = SLOT_FREE;
+    };
+
+    GLStateCache* state = nullptr;
+    Slot slots[SLOTS];
+    i32 width = 0;
+    i32 height = 0;
+    u64 submitted = 0; // frames read into slots
+    u64 handed_off = 0; // frames passed to the writer
+    u64 stalls = 0;
+
+    const char* path = nullptr;
+    bool y4m = false;
+    SDL_IOStream* stream = nullptr;
+    SDL_Thread* writer = nullptr;
+    SpscRing<u32> ready;
+    std::atomic<u32> handoffs = 0;
+    std::atomic<bool> quit = false;
+    std::atomic<u64> written = 0;
+    std::atomic<u64> failures = 0;
+
+    bool initialize(
+        GLStateCache* gl_state,
+        const char* output_path,
+        i32 fb_width,
+        i32 fb_height,
+        i32 fps
+    ) {
+        state = gl_state;
+        path = output_path;
+        width = fb_width;
+        height = fb_height;
+
+        const usize length = SDL_strlen(path);
+        y4m = length >= 4 && SDL_strcasecmp(path + length - 4, ".y4m") == 0;
+        if (y4m) {
+            stream = SDL_IOFromFile(path, "wb");
+            if (!stream) {
+                SDL_Log("Failed to open %s: %s", path, SDL_GetError());
+                return false;
+            }
+            writeY4MHeader(stream, width, height, fps);
+        } else if (SDL_strchr(path, '%') && !isFramePattern(path)) {
+            SDL_Log("%s needs exactly one %%llu conversion for the frame "
+                    "number, such as frame_%%05llu.ppm", path);
+            return false;
+        }
+
+        const usize size = (usize)width * height * 4;
+        const GLbitfield flags =
+            GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        for (auto& slot : slots) {
+            glCreateBuffers(1, &slot.buffer);
+            glNamedBufferStorage(slot.buffer, size, nullptr, flags);
+            slot.pixels = (const u8*)glMapNamedBufferRange(slot.buffer, 0,
+                                                           size, flags);
+            if (!slot.pixels) {
+                SDL_Log("Failed to map capture buffer");
+                shutdown();
+                return false;
+            }
+        }
+
+        ready.initialize(SLOTS);
+        quit = false;
+        writer = SDL_CreateThread(writerMain, "capture", this);
+        if (!writer) {
+            SDL_Log("Failed to start capture thread: %s", SDL_GetError());
+            shutdown();
+            return false;
+        }
+
+        SDL_Log("Recording frames to %s (%s)", path, y4m ? "Y4M" : "PPM");
+        return true;
+    }
+
+    // Queues a readback of `framebuffer` (0 for the window's back buffer).
+    // Call after rendering and before presenting.
+    void capture(GLuint framebuffer, u64 frame) {
+        auto& slot = slots[submitted % SLOTS];
+
+        if (slot.state != SLOT_FREE) {
+            stalls++;
+            // The slot holds the oldest frame still in flight: hand it off
+            // and wait for the writer to give it back.
+            while (slot.state == SLOT_READING) {
+                poll(true);
+            }
+            for (u32 state = slot.state; state != SLOT_FREE;
+                 state = slot.state) {
+                slot.state.wait(state);
+            }
+        }
+
+        state->bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        if (framebuffer) {
+            glNamedFramebufferReadBuffer(framebuffer, GL_COLOR_ATTACHMENT0);
+        } else {
+            glReadBuffer(GL_BACK);
+        }
+        state->bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        // Other readbacks go to client memory.
+        state->bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+        slot.state = SLOT_READING;
+        submitted++;
+    }
+
+    // Hands finished readbacks to the writer, oldest first. With `wait`
+    // set, blocks until the oldest outstanding one has finished.
+    void poll(bool wait) {
+        while (handed_off < submitted) {
+            auto& slot = slots[handed_off % SLOTS];
+
+            const auto status = glClientWaitSync(
+                slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0
+            );
+            if (status == GL_TIMEOUT_EXPIRED) {
+                return;
+            }
+            wait = false;
+
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+            handed_off++;
+
+            // A failed wait never succeeds later (lost context, bad fence),
+            // so drop the frame rather than leave callers waiting on it.
+            if (status == GL_WAIT_FAILED) {
+                SDL_Log("Dropped captured frame %llu: fence wait failed",
+                        (unsigned long long)slot.frame);
+                failures.fetch_add(1, std::memory_order_relaxed);
+                slot.state = SLOT_FREE;
+                continue;
+            }
+
+            slot.state = SLOT_WRITING;
+            ready.push((u32)(&slot - slots));
+
+            handoffs.fetch_add(1);
+            handoffs.notify_one();
+        }
+    }
+
+    // Waits until every captured frame has been written or dropped.
+    void finish() {
+        while (handed_off < submitted) {
+            poll(true);
+        }
+        for (auto& slot : slots) {
+            for (u32 state = slot.state; state != SLOT_FREE;
+                 state = slot.state) {
+                slot.state.wait(state);
+            }
+        }
+    }
+
+    static i32 writerMain(void* user_data) {
+        const auto capture = (FrameCapture*)user_data;
+
+        for (;;) {
+            const u32 seen = capture->handoffs.load();
+
+            u32 index;
+            while (capture->ready.pop(&index)) {
+                capture->write(capture->slots[index]);
+            }
+
+            if (capture->quit) {
+                break;
+            }
+            capture->handoffs.wait(seen);
+        }
+
+        return 0;
+    }
+
+    // Whether `pattern` is safe to use as a printf format with one unsigned
+    // long long argument: one %[0-9]*ll[ud] and otherwise only %%.
+    static bool isFramePattern(const char* pattern) {
+        u32 conversions = 0;
+        for (const char* c = pattern; *c; c++) {
+            if (*c != '%') {
+                continue;
+            }
+            if (c[1] == '%') {
+                c++;
+                continue;
+            }
+
+            c++;
+            while (*c >= '0' && *c <= '9') {
+                c++;
+            }
+            if (c[0] != 'l' || c[1] != 'l' || (c[2] != 'u' && c[2] != 'd')) {
+                return false;
+            }
+            c += 2;
+            conversions++;
+        }
+        return conversions == 1;
+    }
+
+    void write(Slot& slot) {
+        bool ok;
+        if (y4m) {
+            ok = writeY4MFrame(stream, width, height, slot.pixels, true);
+        } else if (SDL_strchr(path, '%')) {
+            char frame_path[1024];
+            SDL_snprintf(frame_path, sizeof(frame_path), path,
+                         (unsigned long long)slot.frame);
+            ok = writePPM(frame_path, width, height, slot.pixels, true);
+        } else {
+            ok = writePPM(path, width, height, slot.pixels, true);
+        }
+
+        if (ok) {
+            written.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            failures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        slot.state = SLOT_FREE;
+        slot.state.notify_one();
+    }
+
+    void shutdown() {
+        if (writer) {
+            finish();
+            quit = true;
+            handoffs.fetch_add(1);
+            handoffs.notify_one();
+            SDL_WaitThread(writer, nullptr);
+            writer = nullptr;
+
+            SDL_Log("Recorded %llu frames (%llu failed, %llu stalls)",
+                    (unsigned long long)written.load(),
+                    (unsigned long long)failures.load(),
+                    (unsigned long long)stalls);
+        }
+
+        for (auto& slot : slots) {
+            if (slot.fence) {
+                glDeleteSync(slot.fence);
+                slot.fence = nullptr;
+            }
+            if (slot.buffer) {
+                glUnmapNamedBuffer(slot.buffer);
+                state->deleteBuffer(&slot.buffer);
+                slot.pixels = nullptr;
+            }
+            slot.state = SLOT_FREE;
+        }
+
+        if (stream) {
+            SDL_CloseIO(stream);
+            stream = nullptr;
+        }
+        ready.shutdown();
+        submitted = handed_off = 0;
+    }
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "types.h"
+
+struct FrameSample {
+    f64 frame_ms; // start of this frame to start of the next
+    f64 cpu_ms;   // frame work on the CPU, excluding the swap
+    f64 gpu_ms;   // GL_TIME_ELAPSED around render()
+    f64 swap_ms;  // SDL_GL_SwapWindow (glFlush when headless)
+};
+
+inline f64 ticksToMs(u64 ticks) {
+    return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// Records per-frame CPU, GPU and swap times for --benchmark runs. GPU times
+// come from a small ring of GL_TIME_ELAPSED queries that are read back
+// QUERY_LATENCY frames late, so collecting them never waits on the GPU
+// while the benchmark is running. Finished samples are appended to an array
+// sized for the whole run, and only sorted and reported once it is over.
+//
+// The first WARMUP_FRAMES frames are not recorded: they pay for shader JIT
+// and first-use allocations, and llvmpipe returns garbage for the very first
+// GL_TIME_ELAPSED query.
+struct FrameProfiler {
+    static constexpr usize QUERY_LATENCY = 4;
+    static constexpr u64 WARMUP_FRAMES = 4;
+
+    GLuint queries[QUERY_LATENCY] = {};
+    FrameSample pending[QUERY_LATENCY] = {};
+    u64 frames_begun = 0;
+    u64 frames_resolved = 0;
+    FrameSample* samples = nullptr;
+    usize sample_count = 0;
+    usize sample_capacity = 0;
+
+    void initialize(u64 frame_count) {
+        glCreateQueries(GL_TIME_ELAPSED, QUERY_LATENCY, queries);
+        sample_capacity = frame_count;
+        samples = (FrameSample*)SDL_malloc(sizeof(FrameSample) * frame_count);
+        sample_count = 0;
+        frames_begun = 0;
+        frames_resolved = 0;
+    }
+
+    void beginGpu() {
+        // All query objects are still in flight: wait for the oldest.
+        if (frames_begun - frames_resolved >= QUERY_LATENCY) {
+            resolve(true);
+        }
+        glBeginQuery(GL_TIME_ELAPSED, queries[frames_begun % QUERY_LATENCY]);
+    }
+
+    void endGpu() { glEndQuery(GL_TIME_ELAPSED); }
+
+    void endFrame(f64 frame_ms, f64 cpu_ms, f64 swap_ms) {
+        auto& sample = pending[frames_begun % QUERY_LATENCY];
+        sample = {frame_ms, cpu_ms, 0.0, swap_ms};
+        frames_begun++;
+
+        resolve(false);
+    }
+
+    // Moves frames whose GPU time is available into `samples`. With
+    // `wait` set, the oldest unresolved frame is read even if that blocks.
+    void resolve(bool wait) {
+        while (frames_resolved < frames_begun) {
+            const auto slot = frames_resolved % QUERY_LATENCY;
+
+            if (!wait) {
+                GLuint available = GL_FALSE;
+                glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT_AVAILABLE,
+                                    &available);
+                if (!available) {
+                    return;
+                }
+            }
+            wait = false;
+
+            GLuint64 elapsed_ns = 0;
+            glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed_ns);
+            pending[slot].gpu_ms = elapsed_ns / 1e6;
+
+            if (frames_resolved >= WARMUP_FRAMES &&
+                sample_count < sample_capacity) {
+                samples[sample_count++] = pending[slot];
+            }
+            frames_resolved++;
+        }
+    }
+
+    void finish() {
+        while (frames_resolved < frames_begun) {
+            resolve(true);
+        }
+    }
+
+    static f64 percentile(const f64* sorted, usize count, f64 p) {
+        if (count == 0) {
+            return 0.0;
+        }
+        // Nearest-rank percentile.
+        usize rank = (usize)SDL_ceil(p / 100.0 * count);
+        rank = SDL_clamp(rank, (usize)1, count);
+        return sorted[rank - 1];
+    }
+
+    static i32 compareF64(const void* a, const void* b) {
+        const f64 lhs = *(const f64*)a;
+        const f64 rhs = *(const f64*)b;
+        return (lhs > rhs) - (lhs < rhs);
+    }
+
+    static void writeSeries(
+        SDL_IOStream* out,
+        const char* name,
+        f64* values,
+        usize count,
+        bool last
+    ) {
+        SDL_qsort(values, count, sizeof(f64), compareF64);
+        SDL_IOprintf(out,
+                     "  \"%s\": {\"p50\": %.4f, \"p95\": %.4f, "
+                     "\"p99\": %.4f, \"max\": %.4f}%s\n",
+                     name, percentile(values, count, 50.0),
+                     percentile(values, count, 95.0),
+                     percentile(values, count, 99.0),
+                     count ? values[count - 1] : 0.0, last ? "" : ",");
+    }
+
+    // Resolves the last frames and writes the summary as JSON to `path`.
+    bool writeReport(const char* path, const char* renderer) {
+        finish();
+
+        const usize count = sample_count;
+        const auto series = (f64*)SDL_malloc(count * 4 * sizeof(f64));
+        f64* frame_ms = series;
+        f64* cpu_ms = series + count;
+        f64* gpu_ms = series + count * 2;
+        f64* swap_ms = series + count * 3;
+
+        f64 seconds = 0.0;
+        for (usize i = 0; i < count; i++) {
+            const FrameSample& sample = samples[i];
+            seconds += sample.frame_ms / 1000.0;
+            frame_ms[i] = sample.frame_ms;
+            cpu_ms[i] = sample.cpu_ms;
+            gpu_ms[i] = sample.gpu_ms;
+            swap_ms[i] = sample.swap_ms;
+        }
+
+        SDL_IOStream* out = SDL_IOFromFile(path, "w");
+        if (!out) {
+            SDL_Log("Failed to open %s: %s", path, SDL_GetError());
+            SDL_free(series);
+            return false;
+        }
+
+        SDL_IOprintf(out, "{\n");
+        SDL_IOprintf(out, "  \"renderer\": \"%s\",\n", renderer);
+        SDL_IOprintf(out, "  \"frames\": %llu,\n", (unsigned long long)count);
+        SDL_IOprintf(out, "  \"seconds\": %.4f,\n", seconds);
+        SDL_IOprintf(out, "  \"fps\": %.2f,\n",
+                     seconds > 0.0 ? count / seconds : 0.0);
+        writeSeries(out, "frame_ms", frame_ms, count, false);
+        writeSeries(out, "cpu_ms", cpu_ms, count, false);
+        writeSeries(out, "gpu_ms", gpu_ms, count, false);
+        writeSeries(out, "swap_ms", swap_ms, count, true);
+        SDL_IOprintf(out, "}\n");
+
+        SDL_free(series);
+        return SDL_CloseIO(out);
+    }
+
+    void shutdown() {
+        if (queries[0]) {
+            glDeleteQueries(QUERY_LATENCY, queries);
+            SDL_memset(queries, 0, sizeof(queries));
+        }
+        SDL_free(samples);
+        samples = nullptr;
+        sample_count = sample_capacity = 0;
+    }
+};
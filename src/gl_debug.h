@@ -0,0 +1,90 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+#include "types.h"
+
+// Where the application currently is, so debug messages can be tied back to
+// a frame and a call site without polling glGetError after every call.
+// Release builds get messages on a driver thread, so both are atomic; the
+// pair is only approximate there anyway, since the message can be late.
+struct GLDebugContext {
+    std::atomic<u64> frame = 0;
+    std::atomic<const char*> site = "startup";
+
+    void setFrame(u64 current) {
+        frame.store(current, std::memory_order_relaxed);
+    }
+
+    void setSite(const char* current) {
+        site.store(current, std::memory_order_relaxed);
+    }
+};
+
+inline const char* getDebugSourceName(GLenum source) {
+    switch (source) {
+        case GL_DEBUG_SOURCE_API: return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "WINDOW_SYSTEM";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "SHADER_COMPILER";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "THIRD_PARTY";
+        case GL_DEBUG_SOURCE_APPLICATION: return "APPLICATION";
+        default: return "OTHER";
+    }
+}
+
+inline const char* getDebugTypeName(GLenum type) {
+    switch (type) {
+        case GL_DEBUG_TYPE_ERROR: return "ERROR";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "UNDEFINED";
+        case GL_DEBUG_TYPE_PORTABILITY: return "PORTABILITY";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "PERFORMANCE";
+        default: return "OTHER";
+    }
+}
+
+inline const char* getDebugSeverityName(GLenum severity) {
+    switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH: return "HIGH";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "MEDIUM";
+        case GL_DEBUG_SEVERITY_LOW: return "LOW";
+        default: return "NOTIFICATION";
+    }
+}
+
+inline void APIENTRY glDebugCallback(
+    GLenum source,
+    GLenum type,
+    GLuint id,
+    GLenum severity,
+    GLsizei length,
+    const GLchar* message,
+    const void* user_param
+) {
+    (void)length;
+    const auto context = (const GLDebugContext*)user_param;
+
+    SDL_Log("OpenGL %s %s (%s, id %u) at frame %llu in %s: %s",
+            getDebugSeverityName(severity), getDebugTypeName(type),
+            getDebugSourceName(source), id,
+            (unsigned long long)context->frame.load(std::memory_order_relaxed),
+            context->site.load(std::memory_order_relaxed), message);
+}
+
+// Routes driver messages to SDL_Log. Debug builds make the output
+// synchronous so a message is reported from inside the offending call (and
+// the site is exact); release builds keep it asynchronous so the driver is
+// free to defer it, and never poll glGetError.
+inline void enableGLDebugOutput(const GLDebugContext* context) {
+    glEnable(GL_DEBUG_OUTPUT);
+#ifndef NDEBUG
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+    glDebugMessageCallback(glDebugCallback, context);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE,
+                          GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr,
+                          GL_FALSE);
+}
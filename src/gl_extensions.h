@@ -0,0 +1,20 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+// Works for any current context, unlike SDL_GL_ExtensionSupported which
+// needs an SDL-created one (the headless backend creates its own via EGL).
+inline bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    for (GLint i = 0; i < count; i++) {
+        const auto extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && SDL_strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
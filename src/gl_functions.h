@@ -0,0 +1,23 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include "types.h"
+
+// Every entry point of the generated loader, in the order of
+// glad/glad_functions.h.
+enum GLFunction : u32 {
+#define GLAD_FUNCTION(name) GL_FUNCTION_##name,
+#include "glad/glad_functions.h"
+#undef GLAD_FUNCTION
+    GL_FUNCTION_COUNT
+};
+
+inline const char* glFunctionName(u32 function) {
+    static constexpr const char* NAMES[] = {
+#define GLAD_FUNCTION(name) #name,
+#include "glad/glad_functions.h"
+#undef GLAD_FUNCTION
+    };
+    return NAMES[function];
+}
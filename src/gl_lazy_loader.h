@@ -0,0 +1,111 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include <type_traits>
+
+#include "gl_functions.h"
+#include "types.h"
+
+// Alternative to gladLoadGLLoader(), which looks up all of the GL 1.0-4.5
+// entry points at startup while the app calls a few dozen. load() points
+// each glad_gl* pointer at a trampoline of its own instead. The first call
+// through a trampoline looks its function up with the loader, stores it in
+// the pointer in place of the trampoline and forwards the call, so later
+// calls go straight to the driver and entry points never called are never
+// looked up.
+//
+// Before its first call a pointer is never null, and GLVersion and the
+// GLAD_GL_VERSION_* flags are not set, so check support through
+// glGetString() or glGetIntegerv() instead. resolveAll() before
+// GLProfiler::enable(), or the trampolines replace its wrappers as they
+// resolve. GL thread only.
+struct GLLazyLoader {
+    GLADloadproc loader = nullptr;
+    void (*resolvers[GL_FUNCTION_COUNT])() = {};
+    bool resolved[GL_FUNCTION_COUNT] = {};
+    u32 resolved_count = 0;
+    u64 resolve_ticks = 0; // SDL_GetPerformanceCounter(), in the loader
+
+    template <
+        u32 INDEX,
+        auto* POINTER,
+        typename F = std::remove_pointer_t<decltype(POINTER)>
+    >
+    struct Trampoline;
+
+    template <u32 INDEX, auto* POINTER>
+    void install() {
+        *POINTER = &Trampoline<INDEX, POINTER>::call;
+        resolvers[INDEX] = &Trampoline<INDEX, POINTER>::resolve;
+    }
+
+    // Returns false when the context reports no GL version, as
+    // gladLoadGLLoader() does. Only glGetString is looked up here.
+    bool load(GLADloadproc proc) {
+        loader = proc;
+        SDL_memset(resolved, 0, sizeof(resolved));
+        resolved_count = 0;
+        resolve_ticks = 0;
+
+#define GLAD_FUNCTION(name) install<GL_FUNCTION_##name, &glad_##name>();
+#include "glad/glad_functions.h"
+#undef GLAD_FUNCTION
+
+        return glGetString(GL_VERSION) != nullptr;
+    }
+
+    void resolve(u32 function) {
+        if (!resolved[function]) {
+            resolvers[function]();
+        }
+    }
+
+    void resolveAll() {
+        for (u32 i = 0; i < GL_FUNCTION_COUNT; i++) {
+            resolve(i);
+        }
+    }
+
+    // The driver's function, or nullptr when it has none, which is what
+    // gladLoadGLLoader() would have left in the pointer.
+    void* lookup(u32 function) {
+        const u64 start = SDL_GetPerformanceCounter();
+        void* address = (void*)loader(glFunctionName(function));
+        resolve_ticks += SDL_GetPerformanceCounter() - start;
+
+        resolved[function] = true;
+        resolved_count++;
+        if (!address) {
+            SDL_Log("GL function %s is unavailable", glFunctionName(function));
+        }
+        return address;
+    }
+
+    void logTotals() const {
+        SDL_Log("Lazy GL loader: %u of %u entry points resolved in %.3f ms",
+                resolved_count, (u32)GL_FUNCTION_COUNT,
+                resolve_ticks * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+};
+
+inline GLLazyLoader gl_lazy_loader;
+
+// Stands in for the entry point INDEX, stored in *POINTER, until its first
+// call. A function the driver lacks does nothing on that call and leaves a
+// null pointer behind, as with gladLoadGLLoader().
+template <u32 INDEX, auto* POINTER, typename R, typename... Args>
+struct GLLazyLoader::Trampoline<INDEX, POINTER, R(APIENTRYP)(Args...)> {
+    using Function = R(APIENTRYP)(Args...);
+
+    static void resolve() { *POINTER = (Function)gl_lazy_loader.lookup(INDEX); }
+
+    static R APIENTRY call(Args... args) {
+        resolve();
+        if (!*POINTER) {
+            return R();
+        }
+        return (*POINTER)(args...);
+    }
+};
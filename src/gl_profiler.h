@@ -0,0 +1,142 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "gl_functions.h"
+#include "types.h"
+
+struct GLFunctionStats {
+    u64 calls;
+    u64 ticks; // SDL_GetPerformanceCounter()
+};
+
+// Call counts and CPU time per GL entry point. enable() swaps every loaded
+// glad_gl* pointer for a wrapper that times the driver function it replaced,
+// and disable() swaps the originals back, so with the profiler off GL calls
+// cost exactly what they did before: there is no check on the call path.
+// The time includes the driver's own CPU work, such as validation and
+// command building, but not the GPU's. GL thread only.
+struct GLProfiler {
+    static constexpr i32 TOP_COUNT = 10;
+
+    void* real[GL_FUNCTION_COUNT] = {};
+    GLFunctionStats stats[GL_FUNCTION_COUNT] = {}; // of the current interval
+    bool enabled = false;
+    u32 report_interval = 1; // frames per report
+    u32 frames = 0;          // in the current interval
+
+    template <u32 INDEX, typename F>
+    struct Wrapper;
+
+    template <u32 INDEX, typename R, typename... Args>
+    struct Wrapper<INDEX, R(APIENTRYP)(Args...)>;
+
+    template <u32 INDEX, typename F>
+    void wrap(F& pointer) {
+        real[INDEX] = (void*)pointer;
+        if (pointer) {
+            pointer = &Wrapper<INDEX, F>::call;
+        }
+    }
+
+    template <u32 INDEX, typename F>
+    void unwrap(F& pointer) {
+        pointer = (F)real[INDEX];
+    }
+
+    // Call after the loader; functions loaded later are not wrapped.
+    void enable(u32 interval) {
+        if (enabled) {
+            return;
+        }
+
+#define GLAD_FUNCTION(name) wrap<GL_FUNCTION_##name>(glad_##name);
+#include "glad/glad_functions.h"
+#undef GLAD_FUNCTION
+
+        enabled = true;
+        report_interval = SDL_max(interval, 1u);
+        frames = 0;
+        SDL_memset(stats, 0, sizeof(stats));
+    }
+
+    void disable() {
+        if (!enabled) {
+            return;
+        }
+
+#define GLAD_FUNCTION(name) unwrap<GL_FUNCTION_##name>(glad_##name);
+#include "glad/glad_functions.h"
+#undef GLAD_FUNCTION
+
+        enabled = false;
+    }
+
+    // Logs the top entry points every `report_interval` frames, averaged
+    // per frame. Returns whether it logged.
+    bool endFrame() {
+        if (!enabled || ++frames < report_interval) {
+            return false;
+        }
+
+        u32 order[GL_FUNCTION_COUNT];
+        u32 count = 0;
+        u64 total_calls = 0;
+        u64 total_ticks = 0;
+        for (u32 i = 0; i < GL_FUNCTION_COUNT; i++) {
+            if (stats[i].calls > 0) {
+                order[count++] = i;
+                total_calls += stats[i].calls;
+                total_ticks += stats[i].ticks;
+            }
+        }
+
+        SDL_qsort_r(order, count, sizeof(u32), compareTicks, stats);
+
+        const f64 us_per_tick = 1e6 / SDL_GetPerformanceFrequency();
+        SDL_Log("GL calls: %.1f calls and %.1f us per frame over %u frames",
+                (f64)total_calls / frames, total_ticks * us_per_tick / frames,
+                frames);
+        for (u32 i = 0; i < SDL_min(count, (u32)TOP_COUNT); i++) {
+            const GLFunctionStats& entry = stats[order[i]];
+            SDL_Log("  %-36s %10.1f calls %10.2f us %8.3f us/call",
+                    glFunctionName(order[i]), (f64)entry.calls / frames,
+                    entry.ticks * us_per_tick / frames,
+                    entry.ticks * us_per_tick / entry.calls);
+        }
+
+        frames = 0;
+        SDL_memset(stats, 0, sizeof(stats));
+        return true;
+    }
+
+    static i32 compareTicks(void* user_data, const void* a, const void* b) {
+        const auto stats = (const GLFunctionStats*)user_data;
+        const u64 lhs = stats[*(const u32*)a].ticks;
+        const u64 rhs = stats[*(const u32*)b].ticks;
+        return (lhs < rhs) - (lhs > rhs);
+    }
+};
+
+inline GLProfiler gl_profiler;
+
+// Times one call of the entry point INDEX, whose driver function enable()
+// saved in real[INDEX].
+template <u32 INDEX, typename R, typename... Args>
+struct GLProfiler::Wrapper<INDEX, R(APIENTRYP)(Args...)> {
+    struct Timer {
+        u64 start = SDL_GetPerformanceCounter();
+
+        ~Timer() {
+            GLFunctionStats& entry = gl_profiler.stats[INDEX];
+            entry.calls++;
+            entry.ticks += SDL_GetPerformanceCounter() - start;
+        }
+    };
+
+    static R APIENTRY call(Args... args) {
+        Timer timer;
+        return ((R(APIENTRYP)(Args...))gl_profiler.real[INDEX])(args...);
+    }
+};
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "types.h"
+
+struct GLStateCounters {
+    u64 issued; // calls that reached the driver
+    u64 elided; // calls dropped because the state was already set
+};
+
+// Shadow copy of the bind points and fixed-function state the renderer
+// touches, so that setting a value that is already current never reaches
+// the driver. All binds must go through the cache once it is in use; code
+// that changes state behind its back has to call invalidate(). Unknown
+// values (after invalidate()) always issue the call.
+//
+// Deleting a bound object resets its bindings in GL, and the name can be
+// handed out again by the next glCreate*, so buffers are deleted through
+// deleteBuffer() (or announced with forgetBuffer()) and textures through
+// deleteTexture() to keep the shadow copy in step.
+struct GLStateCache {
+    static constexpr GLuint UNKNOWN = ~0u;
+    static constexpr u32 MAX_TEXTURE_UNITS = 32;
+    static constexpr u32 MAX_INDEXED_BINDINGS = 16;
+
+    // Non-indexed buffer targets that are tracked; others always issue.
+    static constexpr GLenum BUFFER_TARGETS[] = {
+        GL_ARRAY_BUFFER,
+        GL_PIXEL_PACK_BUFFER,
+        GL_PIXEL_UNPACK_BUFFER,
+        GL_DRAW_INDIRECT_BUFFER,
+        GL_DISPATCH_INDIRECT_BUFFER,
+    };
+    static constexpr usize BUFFER_TARGET_COUNT = SDL_arraysize(BUFFER_TARGETS);
+
+    static constexpr GLenum CAPABILITIES[] = {
+        GL_BLEND,
+        GL_DEPTH_TEST,
+        GL_CULL_FACE,
+        GL_SCISSOR_TEST,
+    };
+    static constexpr usize CAPABILITY_COUNT = SDL_arraysize(CAPABILITIES);
+
+    struct IndexedBinding {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size; // 0 for glBindBufferBase
+    };
+
+    GLuint program;
+    GLuint vertex_array;
+    GLuint draw_framebuffer;
+    GLuint read_framebuffer;
+    GLuint buffers[BUFFER_TARGET_COUNT];
+    GLuint textures[MAX_TEXTURE_UNITS];
+    IndexedBinding storage_buffers[MAX_INDEXED_BINDINGS];
+    IndexedBinding uniform_buffers[MAX_INDEXED_BINDINGS];
+    GLenum capabilities[CAPABILITY_COUNT]; // GL_TRUE, GL_FALSE or UNKNOWN
+    GLenum blend_src;
+    GLenum blend_dst;
+    GLenum depth_func;
+    GLenum depth_mask;
+    GLint patch_vertices;
+    GLint viewport[4];
+
+    GLStateCounters frame = {};
+    GLStateCounters total = {};
+    GLStateCounters peak = {}; // of one frame
+    u64 frames = 0;
+
+    GLStateCache() { invalidate(); }
+
+    void invalidate() {
+        program = vertex_array = UNKNOWN;
+        draw_framebuffer = read_framebuffer = UNKNOWN;
+        for (auto& buffer : buffers) {
+            buffer = UNKNOWN;
+        }
+        for (auto& texture : textures) {
+            texture = UNKNOWN;
+        }
+        for (u32 i = 0; i < MAX_INDEXED_BINDINGS; i++) {
+            storage_buffers[i] = {UNKNOWN, 0, 0};
+            uniform_buffers[i] = {UNKNOWN, 0, 0};
+        }
+        for (auto& capability : capabilities) {
+            capability = UNKNOWN;
+        }
+        blend_src = blend_dst = depth_func = depth_mask = UNKNOWN;
+        patch_vertices = -1;
+        viewport[0] = viewport[1] = viewport[2] = viewport[3] = -1;
+    }
+
+    // Folds the counters of the frame that just ended into the totals.
+    void beginFrame() {
+        total.issued += frame.issued;
+        total.elided += frame.elided;
+        peak.issued = SDL_max(peak.issued, frame.issued);
+        peak.elided = SDL_max(peak.elided, frame.elided);
+        frame = {};
+        frames++;
+    }
+
+    bool changed(bool differs) {
+        if (differs) {
+            frame.issued++;
+        } else {
+            frame.elided++;
+        }
+        return differs;
+    }
+
+    void useProgram(GLuint new_program) {
+        if (changed(program != new_program)) {
+            program = new_program;
+            glUseProgram(new_program);
+        }
+    }
+
+    void bindVertexArray(GLuint new_vertex_array) {
+        if (changed(vertex_array != new_vertex_array)) {
+            vertex_array = new_vertex_array;
+            glBindVertexArray(new_vertex_array);
+        }
+    }
+
+    void bindFramebuffer(GLenum target, GLuint framebuffer) {
+        const bool draw = target != GL_READ_FRAMEBUFFER;
+        const bool read = target != GL_DRAW_FRAMEBUFFER;
+        if (changed((draw && draw_framebuffer != framebuffer) ||
+                    (read && read_framebuffer != framebuffer))) {
+            if (draw) {
+                draw_framebuffer = framebuffer;
+            }
+            if (read) {
+                read_framebuffer = framebuffer;
+            }
+            glBindFramebuffer(target, framebuffer);
+        }
+    }
+
+    static i32 bufferSlot(GLenum target) {
+        for (usize i = 0; i < BUFFER_TARGET_COUNT; i++) {
+            if (BUFFER_TARGETS[i] == target) {
+                return (i32)i;
+            }
+        }
+        return -1;
+    }
+
+    void bindBuffer(GLenum target, GLuint buffer) {
+        const i32 slot = bufferSlot(target);
+        if (changed(slot < 0 || buffers[slot] != buffer)) {
+            if (slot >= 0) {
+                buffers[slot] = buffer;
+            }
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    IndexedBinding* indexedBinding(GLenum target, GLuint index) {
+        if (index >= MAX_INDEXED_BINDINGS) {
+            return nullptr;
+        }
+        switch (target) {
+            case GL_SHADER_STORAGE_BUFFER: return &storage_buffers[index];
+            case GL_UNIFORM_BUFFER: return &uniform_buffers[index];
+            default: return nullptr;
+        }
+    }
+
+    void bindBufferRange(
+        GLenum target,
+        GLuint index,
+        GLuint buffer,
+        GLintptr offset,
+        GLsizeiptr size
+    ) {
+        const auto binding = indexedBinding(target, index);
+        if (changed(!binding || binding->buffer != buffer ||
+                    binding->offset != offset || binding->size != size)) {
+            if (binding) {
+                *binding = {buffer, offset, size};
+            }
+            glBindBufferRange(target, index, buffer, offset, size);
+        }
+    }
+
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+        const auto binding = indexedBinding(target, index);
+        if (changed(!binding || binding->buffer != buffer ||
+                    binding->offset != 0 || binding->size != 0)) {
+            if (binding) {
+                *binding = {buffer, 0, 0};
+            }
+            glBindBufferBase(target, index, buffer);
+        }
+    }
+
+    void bindTextureUnit(GLuint unit, GLuint texture) {
+        const bool tracked = unit < MAX_TEXTURE_UNITS;
+        if (changed(!tracked || textures[unit] != texture)) {
+            if (tracked) {
+                textures[unit] = texture;
+            }
+            glBindTextureUnit(unit, texture);
+        }
+    }
+
+    static i32 capabilitySlot(GLenum capability) {
+        for (usize i = 0; i < CAPABILITY_COUNT; i++) {
+            if (CAPABILITIES[i] == capability) {
+                return (i32)i;
+            }
+        }
+        return -1;
+    }
+
+    void setEnabled(GLenum capability, bool enabled) {
+        const i32 slot = capabilitySlot(capability);
+        const GLenum value = enabled ? GL_TRUE : GL_FALSE;
+        if (changed(slot < 0 || capabilities[slot] != value)) {
+            if (slot >= 0) {
+                capabilities[slot] = value;
+            }
+            if (enabled) {
+                glEnable(capability);
+            } else {
+                glDisable(capability);
+            }
+        }
+    }
+
+    void blendFunc(GLenum src, GLenum dst) {
+        if (changed(blend_src != src || blend_dst != dst)) {
+            blend_src = src;
+            blend_dst = dst;
+            glBlendFunc(src, dst);
+        }
+    }
+
+    void depthFunc(GLenum func) {
+        if (changed(depth_func != func)) {
+            depth_func = func;
+            glDepthFunc(func);
+        }
+    }
+
+    void depthMask(bool write) {
+        const GLenum value = write ? GL_TRUE : GL_FALSE;
+        if (changed(depth_mask != value)) {
+            depth_mask = value;
+            glDepthMask(value);
+        }
+    }
+
+    void patchVertices(GLint count) {
+        if (changed(patch_vertices != count)) {
+            patch_vertices = count;
+            glPatchParameteri(GL_PATCH_VERTICES, count);
+        }
+    }
+
+    void setViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (changed(viewport[0] != x || viewport[1] != y ||
+                    viewport[2] != width || viewport[3] != height)) {
+            viewport[0] = x;
+            viewport[1] = y;
+            viewport[2] = width;
+            viewport[3] = height;
+            glViewport(x, y, width, height);
+        }
+    }
+
+    // Call before deleting `buffer` elsewhere: GL unbinds it everywhere.
+    void forgetBuffer(GLuint buffer) {
+        if (!buffer) {
+            return;
+        }
+
+        for (auto& bound : buffers) {
+            if (bound == buffer) {
+                bound = 0;
+            }
+        }
+        for (u32 i = 0; i < MAX_INDEXED_BINDINGS; i++) {
+            if (storage_buffers[i].buffer == buffer) {
+                storage_buffers[i] = {0, 0, 0};
+            }
+            if (uniform_buffers[i].buffer == buffer) {
+                uniform_buffers[i] = {0, 0, 0};
+            }
+        }
+    }
+
+    void deleteBuffer(GLuint* buffer) {
+        forgetBuffer(*buffer);
+        glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+
+    // GL binds 0 wherever a deleted framebuffer was bound.
+    void deleteFramebuffer(GLuint* framebuffer) {
+        if (*framebuffer) {
+            if (draw_framebuffer == *framebuffer) {
+                draw_framebuffer = 0;
+            }
+            if (read_framebuffer == *framebuffer) {
+                read_framebuffer = 0;
+            }
+        }
+        glDeleteFramebuffers(1, framebuffer);
+        *framebuffer = 0;
+    }
+
+    void deleteTexture(GLuint* texture) {
+        if (*texture) {
+            for (auto& bound : textures) {
+                if (bound == *texture) {
+                    bound = 0;
+                }
+            }
+        }
+        glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+
+    // Logs the counts of the current frame; call at its end.
+    void logFrame() const {
+        SDL_Log("GL state cache: %llu calls issued, %llu elided this frame",
+                (unsigned long long)frame.issued,
+                (unsigned long long)frame.elided);
+    }
+
+    void logTotals() const {
+        const u64 issued = total.issued + frame.issued;
+        const u64 elided = total.elided + frame.elided;
+        const f64 per_frame = frames ? 1.0 / frames : 0.0;
+        SDL_Log("GL state cache: %llu calls issued, %llu elided "
+                "(%.1f / %.1f per frame, at most %llu / %llu)",
+                (unsigned long long)issued, (unsigned long long)elided,
+                issued * per_frame, elided * per_frame,
+                (unsigned long long)SDL_max(peak.issued, frame.issued),
+                (unsigned long long)SDL_max(peak.elided, frame.elided));
+    }
+};
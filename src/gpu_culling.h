@@ -0,0 +1,291 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "command_queue.h"
+#include "gl_state.h"
+#include "instances.h"
+#include "multi_draw.h"
+#include "types.h"
+
+// Frustum and occlusion culling on the GPU. cull() runs cull_compute.glsl
+// over the frame's instances and compacts the survivors, in order, into
+// `visible`, counting them into a DrawArraysIndirectCommand that
+// drawCommand() describes, so the CPU never learns how many were drawn.
+// Occlusion is tested against a hierarchical-Z pyramid that buildPyramid()
+// makes from the depth buffer after the frame has been drawn; the next frame
+// tests against it, which can let an object that just came out from behind
+// an occluder pop in one frame late.
+struct GpuCulling {
+    // Must match cull_compute.glsl.
+    enum Phase : u32 {
+        PHASE_TEST,
+        PHASE_SCAN,
+        PHASE_SCATTER,
+    };
+    static constexpr u32 GROUP_SIZE = 64;
+
+    GLStateCache* state = nullptr;
+    GLuint cull_program = 0;
+    GLuint hiz_program = 0;
+    GLint offset_location = -1;
+    GLint total_count_location = -1;
+    GLint occlusion_location = -1;
+    GLint phase_location = -1;
+    GLint from_depth_location = -1;
+    GLuint visible = 0;
+    GLuint flags = 0;  // one u32 per instance
+    GLuint groups = 0; // one u32 per workgroup
+    GLuint command = 0;
+    u32 capacity = 0; // in instances
+
+    // The depth buffer is blitted into depth_texture, which unlike a
+    // renderbuffer or the default framebuffer can be sampled.
+    GLuint depth_texture = 0;
+    GLuint depth_framebuffer = 0;
+    GLuint pyramid = 0;
+    i32 width = 0;
+    i32 height = 0;
+    i32 levels = 0;
+    bool has_pyramid = false;
+    bool occlusion = true;
+
+    // Takes ownership of both programs.
+    bool initialize(GLStateCache* gl_state, GLuint cull, GLuint hiz) {
+        if (!cull || !hiz) {
+            glDeleteProgram(cull);
+            glDeleteProgram(hiz);
+            return false;
+        }
+
+        state = gl_state;
+        cull_program = cull;
+        hiz_program = hiz;
+        offset_location = glGetUniformLocation(cull, "offset");
+        total_count_location = glGetUniformLocation(cull, "total_count");
+        occlusion_location = glGetUniformLocation(cull, "occlusion");
+        phase_location = glGetUniformLocation(cull, "phase");
+        from_depth_location = glGetUniformLocation(hiz, "from_depth");
+
+        const DrawArraysIndirectCommand initial = {3, 0, 0, 0};
+        glCreateBuffers(1, &command);
+        glNamedBufferStorage(command, sizeof(initial), &initial,
+                             GL_DYNAMIC_STORAGE_BIT);
+
+        return true;
+    }
+
+    void reserve(u32 instance_count) {
+        if (instance_count <= capacity) {
+            return;
+        }
+
+        capacity = SDL_max(instance_count, capacity * 2);
+        state->deleteBuffer(&visible);
+        state->deleteBuffer(&flags);
+        state->deleteBuffer(&groups);
+        glCreateBuffers(1, &visible);
+        glNamedBufferStorage(visible, sizeof(Instance) * capacity, nullptr, 0);
+        glCreateBuffers(1, &flags);
+        glNamedBufferStorage(flags, sizeof(u32) * capacity, nullptr, 0);
+        glCreateBuffers(1, &groups);
+        glNamedBufferStorage(groups, sizeof(u32) * groupCount(capacity),
+                             nullptr, 0);
+    }
+
+    static u32 groupCount(u32 instance_count) {
+        return (instance_count + GROUP_SIZE - 1) / GROUP_SIZE;
+    }
+
+    // Culls `instance_count` instances read from `source` at
+    // `source_offset`, as drawn with the global `offset`.
+    void cull(
+        GLuint source,
+        GLintptr source_offset,
+        u32 instance_count,
+        const f32* offset
+    ) {
+        reserve(instance_count);
+
+        state->useProgram(cull_program);
+        glProgramUniform4fv(cull_program, offset_location, 1, offset);
+        glProgramUniform1ui(cull_program, total_count_location,
+                            instance_count);
+        glProgramUniform1i(cull_program, occlusion_location,
+                           occlusion && has_pyramid);
+        state->bindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, source,
+                               source_offset,
+                               sizeof(Instance) * instance_count);
+        state->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visible);
+        state->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, command);
+        state->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, flags);
+        state->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, groups);
+        state->bindTextureUnit(0, pyramid);
+
+        const u32 group_count = groupCount(instance_count);
+        glProgramUniform1ui(cull_program, phase_location, PHASE_TEST);
+        glDispatchCompute(group_count, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glProgramUniform1ui(cull_program, phase_location, PHASE_SCAN);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glProgramUniform1ui(cull_program, phase_location, PHASE_SCATTER);
+        glDispatchCompute(group_count, 1, 1);
+
+        // The survivors are read as instance attributes and the count as
+        // a draw command.
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                        GL_COMMAND_BARRIER_BIT);
+    }
+
+    // The draw of the survivors of the last cull(), with `vertex_array`
+    // sourcing its instances from `visible`.
+    DrawCommand drawCommand(
+        GLenum mode,
+        GLuint program,
+        GLuint vertex_array
+    ) const {
+        DrawCommand draw = {};
+        draw.program = program;
+        draw.vertex_array = vertex_array;
+        draw.mode = mode;
+        draw.kind = DRAW_ARRAYS_INDIRECT;
+        draw.instances = visible;
+        draw.indirect = command;
+        return draw;
+    }
+
+    // How many instances the last cull() let through. Waits for the GPU.
+    u32 readVisibleCount() {
+        GLuint count = 0;
+        glGetNamedBufferSubData(command,
+                                offsetof(DrawArraysIndirectCommand,
+                                         instance_count),
+                                sizeof(count), &count);
+        return count;
+    }
+
+    // A texture format the depth of `framebuffer` can be blitted into;
+    // blits need the formats to match exactly.
+    static GLenum depthFormatOf(GLuint framebuffer) {
+        const GLenum attachment = framebuffer ? GL_DEPTH_ATTACHMENT : GL_DEPTH;
+        const GLenum stencil = framebuffer ? GL_STENCIL_ATTACHMENT : GL_STENCIL;
+        GLint depth_bits = 0, stencil_bits = 0, type = GL_NONE;
+        glGetNamedFramebufferAttachmentParameteriv(
+            framebuffer, attachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE,
+            &depth_bits
+        );
+
+        // Sizes can only be queried for attachments that exist.
+        GLint stencil_object = GL_NONE;
+        glGetNamedFramebufferAttachmentParameteriv(
+            framebuffer, stencil, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE,
+            &stencil_object
+        );
+        if (stencil_object != GL_NONE) {
+            glGetNamedFramebufferAttachmentParameteriv(
+                framebuffer, stencil, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE,
+                &stencil_bits
+            );
+        }
+        glGetNamedFramebufferAttachmentParameteriv(
+            framebuffer, attachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE,
+            &type
+        );
+
+        if (type == GL_FLOAT) {
+            return stencil_bits ? GL_DEPTH32F_STENCIL8
+                                : GL_DEPTH_COMPONENT32F;
+        }
+        if (stencil_bits) {
+            return GL_DEPTH24_STENCIL8;
+        }
+        return depth_bits == 16 ? GL_DEPTH_COMPONENT16
+                                : GL_DEPTH_COMPONENT24;
+    }
+
+    void destroyTargets() {
+        glDeleteFramebuffers(1, &depth_framebuffer);
+        depth_framebuffer = 0;
+        state->deleteTexture(&depth_texture);
+        state->deleteTexture(&pyramid);
+        width = height = levels = 0;
+        has_pyramid = false;
+    }
+
+    void createTargets(GLuint framebuffer, i32 fb_width, i32 fb_height) {
+        destroyTargets();
+        width = fb_width;
+        height = fb_height;
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &depth_texture);
+        glTextureStorage2D(depth_texture, 1, depthFormatOf(framebuffer),
+                           width, height);
+        glTextureParameteri(depth_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(depth_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glCreateFramebuffers(1, &depth_framebuffer);
+        glNamedFramebufferTexture(depth_framebuffer, GL_DEPTH_ATTACHMENT,
+                                  depth_texture, 0);
+
+        levels = 1;
+        while ((width >> levels) > 0 || (height >> levels) > 0) {
+            levels++;
+        }
+        glCreateTextures(GL_TEXTURE_2D, 1, &pyramid);
+        glTextureStorage2D(pyramid, levels, GL_R32F, width, height);
+        glTextureParameteri(pyramid, GL_TEXTURE_MIN_FILTER,
+                            GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteri(pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    // Rebuilds the pyramid from the depth buffer of `framebuffer`.
+    void buildPyramid(GLuint framebuffer, i32 fb_width, i32 fb_height) {
+        if (fb_width != width || fb_height != height) {
+            createTargets(framebuffer, fb_width, fb_height);
+        }
+
+        glBlitNamedFramebuffer(framebuffer, depth_framebuffer, 0, 0, width,
+                               height, 0, 0, width, height,
+                               GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        state->useProgram(hiz_program);
+        state->bindTextureUnit(0, depth_texture);
+        for (i32 level = 0; level < levels; level++) {
+            glProgramUniform1i(hiz_program, from_depth_location, level == 0);
+            if (level > 0) {
+                glBindImageTexture(0, pyramid, level - 1, GL_FALSE, 0,
+                                   GL_READ_ONLY, GL_R32F);
+            }
+            glBindImageTexture(1, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY,
+                               GL_R32F);
+
+            const i32 level_width = SDL_max(width >> level, 1);
+            const i32 level_height = SDL_max(height >> level, 1);
+            glDispatchCompute((level_width + 7) / 8, (level_height + 7) / 8,
+                              1);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        has_pyramid = true;
+    }
+
+    void shutdown() {
+        if (!state) {
+            return;
+        }
+
+        glDeleteProgram(cull_program);
+        glDeleteProgram(hiz_program);
+        cull_program = hiz_program = 0;
+        state->deleteBuffer(&visible);
+        state->deleteBuffer(&flags);
+        state->deleteBuffer(&groups);
+        state->deleteBuffer(&command);
+        capacity = 0;
+        destroyTargets();
+        state = nullptr;
+    }
+};
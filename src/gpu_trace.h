@@ -0,0 +1,125 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "trace.h"
+#include "types.h"
+
+// GPU zones for the Tracer, measured with a GL_TIMESTAMP query at each end.
+// Results are collected by resolve(), which only reads queries the GPU has
+// already written, so tracing never waits on it while frames are running.
+// GPU timestamps are moved onto the SDL_GetTicksNS() time base with an
+// offset measured once in initialize(); the zones go on a track of their own
+// named "GPU".
+struct GpuTracer {
+    static constexpr u32 MAX_PENDING = 1024;
+
+    struct Pending {
+        const char* name;
+        GLuint queries[2];
+        bool ended;
+    };
+
+    GLuint queries[MAX_PENDING * 2] = {};
+    Pending pending[MAX_PENDING] = {};
+    u64 begun = 0;    // zones begun
+    u64 resolved = 0; // of those, zones read back
+    i64 gpu_to_cpu_ns = 0;
+    TraceBuffer* buffer = nullptr;
+    u64 dropped = 0;
+
+    // Call with the context current, after Tracer::initialize().
+    void initialize() {
+        if (!tracer.isEnabled()) {
+            return;
+        }
+
+        glCreateQueries(GL_TIMESTAMP, MAX_PENDING * 2, queries);
+        buffer = tracer.createBuffer("GPU");
+
+        GLint64 gpu_now = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+        gpu_to_cpu_ns = (i64)SDL_GetTicksNS() - gpu_now;
+    }
+
+    // Returns the zone's slot for end(), or -1 when tracing is off or every
+    // slot is waiting for the GPU.
+    i32 begin(const char* name) {
+        if (!buffer) {
+            return -1;
+        }
+        if (begun - resolved == MAX_PENDING) {
+            resolve(false);
+            if (begun - resolved == MAX_PENDING) {
+                dropped++;
+                return -1;
+            }
+        }
+
+        const u32 slot = begun % MAX_PENDING;
+        pending[slot] = {name, {queries[slot * 2], queries[slot * 2 + 1]},
+                         false};
+        glQueryCounter(pending[slot].queries[0], GL_TIMESTAMP);
+        begun++;
+        return (i32)slot;
+    }
+
+    void end(i32 slot) {
+        if (slot >= 0) {
+            glQueryCounter(pending[slot].queries[1], GL_TIMESTAMP);
+            pending[slot].ended = true;
+        }
+    }
+
+    // Moves finished zones into the trace, oldest first, stopping at one
+    // that is still open. With `wait` set it blocks until the GPU gets to
+    // the end of each zone.
+    void resolve(bool wait) {
+        while (resolved < begun) {
+            const Pending& zone = pending[resolved % MAX_PENDING];
+            if (!zone.ended) {
+                return;
+            }
+
+            if (!wait) {
+                GLint available = GL_FALSE;
+                glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE,
+                                   &available);
+                if (!available) {
+                    return;
+                }
+            }
+
+            GLuint64 begin_ns = 0, end_ns = 0;
+            glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &begin_ns);
+            glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end_ns);
+            buffer->push({zone.name, (u64)(begin_ns + gpu_to_cpu_ns),
+                          (u64)(end_ns + gpu_to_cpu_ns)});
+            resolved++;
+        }
+    }
+
+    void shutdown() {
+        if (queries[0]) {
+            glDeleteQueries(MAX_PENDING * 2, queries);
+            SDL_memset(queries, 0, sizeof(queries));
+        }
+        buffer = nullptr;
+        begun = resolved = 0;
+    }
+};
+
+inline GpuTracer gpu_tracer;
+
+// Records the GPU work issued in the enclosing scope as a zone. Only on the
+// thread that owns the GL context.
+struct GpuTraceZone {
+    i32 slot;
+
+    explicit GpuTraceZone(const char* name) : slot(gpu_tracer.begin(name)) {}
+    ~GpuTraceZone() { gpu_tracer.end(slot); }
+};
+
+#define TRACE_GPU_ZONE(name) \
+    GpuTraceZone TRACE_CONCAT(trace_gpu_zone_, __LINE__)(name)
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "gl_state.h"
+#include "types.h"
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// GL 4.5 core context without a window, for machines with no display or GPU
+// (Mesa llvmpipe). The context is created on EGL_MESA_platform_surfaceless,
+// or on a 1x1 pbuffer of the default display when that platform is missing,
+// and rendering goes into an FBO sized like the window would be. The FBO is
+// left bound as the draw framebuffer, so render() runs unchanged.
+struct HeadlessContext {
+#ifdef __linux__
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+#endif
+    GLStateCache* state = nullptr;
+    GLuint fbo = 0;
+    GLuint color_rb = 0;
+    GLuint depth_rb = 0;
+    i32 width = 0;
+    i32 height = 0;
+
+    static GLADloadproc loader() {
+#ifdef __linux__
+        return (GLADloadproc)eglGetProcAddress;
+#else
+        return nullptr;
+#endif
+    }
+
+    // Makes the context current. Load GL entry points through loader() and
+    // then call createFramebuffer().
+    bool initialize(bool debug) {
+#ifdef __linux__
+        const auto client_extensions =
+            eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        const auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+            eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        const bool surfaceless =
+            client_extensions && getPlatformDisplay &&
+            SDL_strstr(client_extensions, "EGL_MESA_platform_surfaceless");
+
+        display = surfaceless
+            ? getPlatformDisplay(
+                  EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr
+              )
+            : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY ||
+            !eglInitialize(display, &major, &minor)) {
+            SDL_Log("Failed to initialize EGL: 0x%x", eglGetError());
+            return false;
+        }
+
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            SDL_Log("EGL has no desktop OpenGL: 0x%x", eglGetError());
+            return false;
+        }
+
+        const EGLint config_attribs[] = {
+            EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE,
+        };
+
+        EGLConfig config = nullptr;
+        EGLint config_count = 0;
+        if (!eglChooseConfig(display, config_attribs, &config, 1,
+                             &config_count) ||
+            config_count == 0) {
+            SDL_Log("No suitable EGL config: 0x%x", eglGetError());
+            return false;
+        }
+
+        const EGLint context_attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 5,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK,
+            EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_CONTEXT_OPENGL_DEBUG, debug ? EGL_TRUE : EGL_FALSE,
+            EGL_NONE,
+        };
+
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+                                   context_attribs);
+        if (context == EGL_NO_CONTEXT) {
+            SDL_Log("Failed to create EGL context: 0x%x", eglGetError());
+            return false;
+        }
+
+        if (!surfaceless) {
+            const EGLint pbuffer_attribs[] = {
+                EGL_WIDTH, 1,
+                EGL_HEIGHT, 1,
+                EGL_NONE,
+            };
+            surface = eglCreatePbufferSurface(display, config,
+                                              pbuffer_attribs);
+            if (surface == EGL_NO_SURFACE) {
+                SDL_Log("Failed to create pbuffer: 0x%x", eglGetError());
+                return false;
+            }
+        }
+
+        if (!eglMakeCurrent(display, surface, surface, context)) {
+            SDL_Log("Failed to make EGL context current: 0x%x",
+                    eglGetError());
+            return false;
+        }
+
+        SDL_Log("Headless EGL %d.%d context (%s)", major, minor,
+                surfaceless ? "surfaceless" : "pbuffer");
+        return true;
+#else
+        (void)debug;
+        SDL_Log("Headless rendering is only supported on Linux");
+        return false;
+#endif
+    }
+
+    // Binds through `gl_state`, as do readPixels() and shutdown().
+    bool createFramebuffer(GLStateCache* gl_state, i32 fb_width,
+                           i32 fb_height) {
+        state = gl_state;
+        width = fb_width;
+        height = fb_height;
+
+        glCreateRenderbuffers(1, &color_rb);
+        glNamedRenderbufferStorage(color_rb, GL_RGBA8, width, height);
+        glCreateRenderbuffers(1, &depth_rb);
+        glNamedRenderbufferStorage(depth_rb, GL_DEPTH_COMPONENT24, width,
+                                   height);
+
+        glCreateFramebuffers(1, &fbo);
+        glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0,
+                                       GL_RENDERBUFFER, color_rb);
+        glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT,
+                                       GL_RENDERBUFFER, depth_rb);
+
+        const auto status = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            SDL_Log("Headless framebuffer incomplete: 0x%x", status);
+            return false;
+        }
+
+        state->bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        return true;
+    }
+
+    // Stands in for SDL_GL_SwapWindow: nothing is shown, but the frame's
+    // commands are handed to the driver so that queued work cannot pile up.
+    void present() { glFlush(); }
+
+    // Synchronous readback of the whole framebuffer as bottom-up RGBA8.
+    void readPixels(u8* rgba) {
+        glNamedFramebufferReadBuffer(fbo, GL_COLOR_ATTACHMENT0);
+        state->bindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    }
+
+    void shutdown() {
+        if (fbo) {
+            state->deleteFramebuffer(&fbo);
+            glDeleteRenderbuffers(1, &color_rb);
+            glDeleteRenderbuffers(1, &depth_rb);
+            color_rb = depth_rb = 0;
+            state = nullptr;
+        }
+
+#ifdef __linux__
+        if (display != EGL_NO_DISPLAY) {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                           EGL_NO_CONTEXT);
+            if (surface != EGL_NO_SURFACE) {
+                eglDestroySurface(display, surface);
+            }
+            if (context != EGL_NO_CONTEXT) {
+                eglDestroyContext(display, context);
+            }
+            eglTerminate(display);
+            display = EGL_NO_DISPLAY;
+            context = EGL_NO_CONTEXT;
+            surface = EGL_NO_SURFACE;
+        }
+#endif
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <math.h>
+
+#include "types.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+struct ImageDiff {
+    u64 pixels;    // pixels compared
+    u64 outliers;  // pixels with a channel off by more than the tolerance
+    u32 max_delta; // largest difference of any channel
+    f64 psnr;      // over RGB, in dB; infinite for identical images
+};
+
+// Compares the RGB channels of two RGBA8 images of `count` pixels. Small
+// differences are expected between drivers (rasterization and rounding
+// along edges), so a pixel only counts as an outlier when one of its
+// channels differs by more than `tolerance`; callers then allow a small
+// fraction of outliers. PSNR summarises how far off the image is overall.
+inline ImageDiff diffImages(
+    const u8* a,
+    const u8* b,
+    usize count,
+    u8 tolerance
+) {
+    ImageDiff diff = {count, 0, 0, 0.0};
+    u64 squared_error = 0;
+    usize i = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // 4 pixels per iteration. Squared errors are summed in 32-bit lanes and
+    // flushed before they can overflow.
+    constexpr usize FLUSH_INTERVAL = 4096;
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i limit = _mm_set1_epi8((char)tolerance);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i max_delta = zero;
+    __m128i sum = zero;
+    usize pending = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128i va = _mm_loadu_si128((const __m128i*)(a + i * 4));
+        const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i * 4));
+        const __m128i delta = _mm_and_si128(
+            _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)),
+            rgb_mask
+        );
+
+        max_delta = _mm_max_epu8(max_delta, delta);
+
+        const __m128i lo = _mm_unpacklo_epi8(delta, zero);
+        const __m128i hi = _mm_unpackhi_epi8(delta, zero);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(lo, lo));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(hi, hi));
+
+        // One bit per channel above the tolerance, folded to one per pixel.
+        u32 over = ~_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_subs_epu8(delta, limit), zero)
+        ) & 0xFFFF;
+        over |= over >> 1;
+        over |= over >> 2;
+        diff.outliers += __builtin_popcount(over & 0x1111);
+
+        if (++pending == FLUSH_INTERVAL || i + 8 > count) {
+            alignas(16) u32 lanes[4];
+            _mm_store_si128((__m128i*)lanes, sum);
+            squared_error += (u64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            sum = zero;
+            pending = 0;
+        }
+    }
+
+    alignas(16) u8 max_bytes[16];
+    _mm_store_si128((__m128i*)max_bytes, max_delta);
+    for (u8 value : max_bytes) {
+        diff.max_delta = SDL_max(diff.max_delta, (u32)value);
+    }
+#endif
+
+    for (; i < count; i++) {
+        bool outlier = false;
+        for (i32 c = 0; c < 3; c++) {
+            const i32 delta = SDL_abs((i32)a[i * 4 + c] - b[i * 4 + c]);
+            squared_error += (u64)(delta * delta);
+            diff.max_delta = SDL_max(diff.max_delta, (u32)delta);
+            outlier = outlier || delta > tolerance;
+        }
+        diff.outliers += outlier;
+    }
+
+    if (squared_error == 0) {
+        diff.psnr = INFINITY;
+    } else {
+        const f64 mse = (f64)squared_error / (count * 3);
+        diff.psnr = 10.0 * SDL_log10(255.0 * 255.0 / mse);
+    }
+    return diff;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include "types.h"
+
+// Writes tightly packed RGBA8 pixels as a binary PPM, dropping alpha. GL
+// readbacks are bottom-up, so `flip_y` restores the usual top-down order.
+inline bool writePPM(
+    const char* path,
+    i32 width,
+    i32 height,
+    const u8* rgba,
+    bool flip_y
+) {
+    SDL_IOStream* file = SDL_IOFromFile(path, "wb");
+    if (!file) {
+        SDL_Log("Failed to open %s: %s", path, SDL_GetError());
+        return false;
+    }
+
+    SDL_IOprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    const auto row = (u8*)SDL_malloc((usize)width * 3);
+    for (i32 y = 0; y < height; y++) {
+        const i32 src_y = flip_y ? height - 1 - y : y;
+        const u8* src = rgba + (usize)src_y * width * 4;
+        for (i32 x = 0; x < width; x++) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        SDL_WriteIO(file, row, (usize)width * 3);
+    }
+    SDL_free(row);
+
+    return SDL_CloseIO(file);
+}
+
+// Header of a raw YUV4MPEG2 stream of full-resolution 4:4:4 frames.
+inline void writeY4MHeader(
+    SDL_IOStream* stream,
+    i32 width,
+    i32 height,
+    i32 fps
+) {
+    SDL_IOprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width,
+                 height, fps);
+}
+
+// Appends one frame to a Y4M stream, converting RGBA8 to limited-range
+// BT.601 YCbCr. `flip_y` works as in writePPM().
+inline bool writeY4MFrame(
+    SDL_IOStream* stream,
+    i32 width,
+    i32 height,
+    const u8* rgba,
+    bool flip_y
+) {
+    const usize plane_size = (usize)width * height;
+    const auto planes = (u8*)SDL_malloc(plane_size * 3);
+    u8* y_plane = planes;
+    u8* u_plane = planes + plane_size;
+    u8* v_plane = planes + plane_size * 2;
+
+    for (i32 y = 0; y < height; y++) {
+        const i32 src_y = flip_y ? height - 1 - y : y;
+        const u8* src = rgba + (usize)src_y * width * 4;
+        const usize dst = (usize)y * width;
+        for (i32 x = 0; x < width; x++) {
+            const i32 r = src[x * 4 + 0];
+            const i32 g = src[x * 4 + 1];
+            const i32 b = src[x * 4 + 2];
+            const i32 luma = (66 * r + 129 * g + 25 * b + 128) >> 8;
+            const i32 cb = (-38 * r - 74 * g + 112 * b + 128) >> 8;
+            const i32 cr = (112 * r - 94 * g - 18 * b + 128) >> 8;
+            y_plane[dst + x] = (u8)(luma + 16);
+            u_plane[dst + x] = (u8)(cb + 128);
+            v_plane[dst + x] = (u8)(cr + 128);
+        }
+    }
+
+    SDL_IOprintf(stream, "FRAME\n");
+    const bool written =
+        SDL_WriteIO(stream, planes, plane_size * 3) == plane_size * 3;
+    SDL_free(planes);
+    return written;
+}
+
+// Reads a binary PPM written by writePPM() into newly allocated RGBA8 pixels
+// (alpha 255), flipping to bottom-up with `flip_y`. Free with SDL_free().
+inline u8* readPPM(const char* path, i32* width, i32* height, bool flip_y) {
+    usize size = 0;
+    const auto data = (u8*)SDL_LoadFile(path, &size);
+    if (!data) {
+        SDL_Log("Failed to read %s: %s", path, SDL_GetError());
+        return nullptr;
+    }
+
+    // Header: "P6", width, height and maxval separated by whitespace, then
+    // a single whitespace byte before the pixels.
+    i32 fields[3] = {};
+    usize at = 2;
+    bool valid = size > 2 && data[0] == 'P' && data[1] == '6';
+    for (i32 f = 0; valid && f < 3; f++) {
+        while (at < size && SDL_isspace(data[at])) {
+            at++;
+        }
+        valid = at < size && SDL_isdigit(data[at]);
+        while (valid && at < size && SDL_isdigit(data[at])) {
+            fields[f] = fields[f] * 10 + (data[at++] - '0');
+            valid = fields[f] <= 65535;
+        }
+    }
+    at++;
+
+    const usize pixel_count = (usize)fields[0] * fields[1];
+    if (!valid || fields[2] != 255 || fields[0] <= 0 || fields[1] <= 0 ||
+        at + pixel_count * 3 > size) {
+        SDL_Log("%s is not an 8-bit binary PPM", path);
+        SDL_free(data);
+        return nullptr;
+    }
+
+    *width = fields[0];
+    *height = fields[1];
+    const auto rgba = (u8*)SDL_malloc(pixel_count * 4);
+    for (i32 y = 0; y < *height; y++) {
+        const i32 src_y = flip_y ? *height - 1 - y : y;
+        const u8* src = data + at + (usize)src_y * *width * 3;
+        u8* dst = rgba + (usize)y * *width * 4;
+        for (i32 x = 0; x < *width; x++) {
+            dst[x * 4 + 0] = src[x * 3 + 0];
+            dst[x * 4 + 1] = src[x * 3 + 1];
+            dst[x * 4 + 2] = src[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+
+    SDL_free(data);
+    return rgba;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "types.h"
+
+// Per-instance vertex data. offset_scale is (x, y, scale, depth) and is
+// consumed by vertex.glsl as attribute 2, depth being added to the clip-space
+// z; color multiplies the vertex color (attribute 1).
+struct Instance {
+    f32 offset_scale[4];
+    f32 color[4];
+};
+
+// Values of the instance attributes while their arrays are disabled, so the
+// single-triangle path draws exactly what it did before instancing existed.
+constexpr Instance DEFAULT_INSTANCE = {
+    {0.0f, 0.0f, 1.0f, 0.0f},
+    {1.0f, 1.0f, 1.0f, 1.0f},
+};
+
+inline void setDefaultInstanceAttribs() {
+    glVertexAttrib4fv(1, DEFAULT_INSTANCE.color);
+    glVertexAttrib4fv(2, DEFAULT_INSTANCE.offset_scale);
+}
+
+// Scatters `count` triangles over the viewport with a deterministic LCG, so
+// every run (and every benchmark step) draws the same scene. Triangles
+// shrink as the count grows to keep the covered area, and so the fill cost,
+// roughly constant.
+inline void generateInstances(Instance* instances, u32 count) {
+    u32 state = 0x12345678;
+    const auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    };
+
+    const f32 scale =
+        SDL_clamp(2.0f / SDL_sqrtf((f32)count), 0.01f, 1.0f);
+
+    for (u32 i = 0; i < count; i++) {
+        instances[i] = {
+            {next() * 2.0f - 1.0f, next() * 2.0f - 1.0f, scale, 0.0f},
+            {next(), next(), next(), 1.0f},
+        };
+    }
+}
+
+// A scene for occlusion culling: generateInstances() pushed back to depths
+// between 0.1 and 0.4, behind a 4x4 grid of large grey triangles at -0.4
+// that hides about half of the screen. The occluders come first, so they
+// are drawn first.
+inline void generateOccludedInstances(Instance* instances, u32 count) {
+    constexpr u32 GRID = 4;
+    generateInstances(instances, count);
+
+    for (u32 i = 0; i < count; i++) {
+        if (i < GRID * GRID) {
+            const f32 cell = 2.0f / GRID;
+            instances[i] = {
+                {-1.0f + cell * (i % GRID + 0.5f),
+                 -1.0f + cell * (i / GRID + 0.5f), cell * 2.0f, -0.4f},
+                {0.5f, 0.5f, 0.5f, 1.0f},
+            };
+        } else {
+            instances[i].offset_scale[3] = 0.1f + 0.3f * (i % 97) / 96.0f;
+        }
+    }
+}
+
+// Sources attributes 1 and 2 from `buffer`, advancing once per instance.
+inline void bindInstanceBuffer(GLuint vao, GLuint buffer) {
+    glVertexArrayVertexBuffer(vao, 0, buffer, 0, sizeof(Instance));
+    glVertexArrayBindingDivisor(vao, 0, 1);
+
+    glVertexArrayAttribFormat(vao, 1, 4, GL_FLOAT, GL_FALSE,
+                              offsetof(Instance, color));
+    glVertexArrayAttribBinding(vao, 1, 0);
+    glEnableVertexArrayAttrib(vao, 1);
+
+    glVertexArrayAttribFormat(vao, 2, 4, GL_FLOAT, GL_FALSE,
+                              offsetof(Instance, offset_scale));
+    glVertexArrayAttribBinding(vao, 2, 0);
+    glEnableVertexArrayAttrib(vao, 2);
+}
+
+inline void unbindInstanceBuffer(GLuint vao) {
+    glDisableVertexArrayAttrib(vao, 1);
+    glDisableVertexArrayAttrib(vao, 2);
+    glVertexArrayVertexBuffer(vao, 0, 0, 0, sizeof(Instance));
+}
+
+// Per-frame motion for streamed instances: every triangle circles its base
+// position with its own phase, written straight into `out`. Only instances
+// [begin, end) are written, so ranges can be animated in parallel.
+inline void animateInstances(
+    Instance* out,
+    const Instance* base,
+    u32 begin,
+    u32 end,
+    f64 time
+) {
+    for (u32 i = begin; i < end; i++) {
+        const f32 phase = (f32)time * 2.0f + i * 0.618f;
+        const f32 radius = base[i].offset_scale[2] * 0.5f;
+
+        out[i] = base[i];
+        out[i].offset_scale[0] += SDL_cosf(phase) * radius;
+        out[i].offset_scale[1] += SDL_sinf(phase) * radius;
+    }
+}
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+#include <new>
+
+#include "trace.h"
+#include "types.h"
+
+// Runs `function` over the items [begin, end) of `data`.
+typedef void (*JobFunction)(void* data, u32 begin, u32 end);
+
+// Counts the jobs still to finish. Every job run() is given a counter, and
+// JobSystem::wait() returns once it drops to zero; several jobs can share a
+// counter, and a job that depends on others waits on theirs.
+struct JobCounter {
+    std::atomic<u32> pending = 0;
+};
+
+struct Job {
+    JobFunction function;
+    void* data;
+    u32 begin;
+    u32 end;
+    u32 grain; // ranges longer than this are split before running
+    JobCounter* counter;
+    std::atomic<bool> in_use; // between run() and finishing
+};
+
+// Chase-Lev work-stealing deque, in the C11 formulation of Le, Pop, Cohen
+// and Zappa Nardelli (2013). The owning worker pushes and pops at the
+// bottom; any other thread steals from the top. The capacity is fixed, and
+// push() fails when it is full.
+struct JobDeque {
+    static constexpr i64 CAPACITY = 4096;
+    static constexpr i64 MASK = CAPACITY - 1;
+
+    alignas(64) std::atomic<i64> top;
+    alignas(64) std::atomic<i64> bottom;
+    std::atomic<Job*> slots[CAPACITY];
+
+    // Owner only.
+    bool push(Job* job) {
+        const i64 b = bottom.load(std::memory_order_relaxed);
+        const i64 t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY) {
+            return false;
+        }
+
+        slots[b & MASK].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only. Takes the newest job, which is the one most likely to
+    // still be in cache.
+    Job* pop() {
+        const i64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        i64 t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = slots[b & MASK].load(std::memory_order_relaxed);
+        if (t == b) {
+            // The last job: race the thieves for it.
+            if (!top.compare_exchange_strong(t, t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Any thread. Takes the oldest job, which for split ranges is the
+    // largest.
+    Job* steal() {
+        i64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const i64 b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+
+        Job* job = slots[t & MASK].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+};
+
+// Which worker the calling thread is; -1 for threads outside the system.
+inline thread_local i32 current_job_worker = -1;
+
+// Work-stealing job scheduler without fibers. Each worker owns a deque it
+// pushes new jobs to and pops from; a worker that runs dry steals from the
+// others, starting at a random one. The thread that calls initialize() is
+// worker 0 and runs jobs whenever it waits, so a count of 1 runs everything
+// on the caller. Idle workers spin briefly and then sleep until the next
+// run(). If a thread fails to start, the system restarts with as many
+// workers as did.
+//
+// Jobs come from a fixed pool per worker. When the pool or the deque is full
+// run() executes the job on the spot instead, which keeps every job correct
+// at the price of parallelism. Only workers may call run() and wait().
+struct JobSystem {
+    static constexpr i32 MAX_WORKERS = 64;
+    static constexpr u32 POOL_SIZE = 4096;
+    static constexpr i32 SPIN_COUNT = 256;
+
+    struct Worker {
+        JobDeque deque;
+        Job pool[POOL_SIZE];
+        u32 next_job;
+        u32 random;
+        JobSystem* system;
+        SDL_Thread* thread;
+        u64 executed; // job bodies run, split-off halves included
+        u64 stolen;
+    };
+
+    Worker* workers = nullptr;
+    i32 worker_count = 0; // including the caller's
+    std::atomic<bool> quit = false;
+    std::atomic<u32> wake = 0;
+    std::atomic<i32> sleeping = 0;
+
+    bool initialize(i32 thread_count) {
+        shutdown();
+
+        const i32 count = SDL_clamp(thread_count, 1, MAX_WORKERS);
+        workers = (Worker*)SDL_aligned_alloc(alignof(Worker),
+                                             sizeof(Worker) * count);
+        if (!workers) {
+            SDL_Log("Failed to allocate %d job workers", count);
+            return false;
+        }
+
+        worker_count = count;
+        quit = false;
+        current_job_worker = 0;
+        for (i32 i = 0; i < count; i++) {
+            new (&workers[i]) Worker{};
+            workers[i].system = this;
+            workers[i].random = 0x9E3779B9u * (i + 1);
+        }
+        for (i32 i = 1; i < count; i++) {
+            workers[i].thread =
+                SDL_CreateThread(workerMain, "job", &workers[i]);
+            if (!workers[i].thread) {
+                SDL_Log("Failed to start job worker: %s", SDL_GetError());
+                // The started workers read worker_count and steal from every
+                // deque, so stop them all before starting over with fewer.
+                shutdown();
+                return initialize(i);
+            }
+        }
+        return true;
+    }
+
+    void shutdown() {
+        if (!workers) {
+            return;
+        }
+
+        quit = true;
+        wake.fetch_add(1);
+        wake.notify_all();
+        for (i32 i = 1; i < worker_count; i++) {
+            if (workers[i].thread) {
+                SDL_WaitThread(workers[i].thread, nullptr);
+            }
+        }
+        for (i32 i = 0; i < worker_count; i++) {
+            workers[i].~Worker();
+        }
+        SDL_aligned_free(workers);
+        workers = nullptr;
+        worker_count = 0;
+        current_job_worker = -1;
+    }
+
+    // Queues function(data, begin, end) on the calling worker and counts it
+    // into `counter`. With a nonzero `grain`, ranges longer than that are
+    // halved, and the halves queued for others to steal, until they are not.
+    void run(
+        JobFunction function,
+        void* data,
+        u32 begin,
+        u32 end,
+        u32 grain,
+        JobCounter* counter
+    ) {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+        Worker& worker = workers[current_job_worker];
+        Job* job = allocate(worker);
+        if (!job) {
+            execute(worker, function, data, begin, end, grain, counter);
+            return;
+        }
+
+        fill(job, function, data, begin, end, grain, counter);
+        if (!worker.deque.push(job)) {
+            job->in_use.store(false, std::memory_order_relaxed);
+            execute(worker, function, data, begin, end, grain, counter);
+            return;
+        }
+        wakeSleepers();
+    }
+
+    // Runs queued jobs, this worker's first and then stolen ones, until
+    // `counter` drops to zero.
+    void wait(JobCounter* counter) {
+        Worker& worker = workers[current_job_worker];
+        while (counter->pending.load(std::memory_order_acquire) > 0) {
+            if (Job* job = findJob(worker)) {
+                execute(worker, job);
+            } else {
+                SDL_CPUPauseInstruction();
+            }
+        }
+    }
+
+    // Calls function(data, begin, end) over [0, count) in ranges of at most
+    // `grain` items on all workers and returns when they are done.
+    void parallelFor(u32 count, u32 grain, JobFunction function, void* data) {
+        if (count == 0) {
+            return;
+        }
+
+        JobCounter counter;
+        run(function, data, 0, count, SDL_max(grain, 1u), &counter);
+        wait(&counter);
+    }
+
+    template <typename F>
+    void parallelFor(u32 count, u32 grain, F&& function) {
+        parallelFor(count, grain, [](void* data, u32 begin, u32 end) {
+            (*(F*)data)(begin, end);
+        }, (void*)&function);
+    }
+
+    // A free pool slot, or nullptr when the next one is still in flight.
+    static Job* allocate(Worker& worker) {
+        Job* job = &worker.pool[worker.next_job % POOL_SIZE];
+        if (job->in_use.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        worker.next_job++;
+        return job;
+    }
+
+    static void fill(
+        Job* job,
+        JobFunction function,
+        void* data,
+        u32 begin,
+        u32 end,
+        u32 grain,
+        JobCounter* counter
+    ) {
+        job->function = function;
+        job->data = data;
+        job->begin = begin;
+        job->end = end;
+        job->grain = grain;
+        job->counter = counter;
+        job->in_use.store(true, std::memory_order_relaxed);
+    }
+
+    void wakeSleepers() {
+        // Orders the push before the read of `sleeping`; a worker going to
+        // sleep increments `sleeping` before its last look at the deques.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed) > 0) {
+            wake.fetch_add(1);
+            wake.notify_all();
+        }
+    }
+
+    Job* findJob(Worker& worker) {
+        if (Job* job = worker.deque.pop()) {
+            return job;
+        }
+
+        // xorshift32
+        worker.random ^= worker.random << 13;
+        worker.random ^= worker.random >> 17;
+        worker.random ^= worker.random << 5;
+
+        const i32 self = (i32)(&worker - workers);
+        const i32 start = (i32)(worker.random % (u32)worker_count);
+        for (i32 i = 0; i < worker_count; i++) {
+            const i32 victim = (start + i) % worker_count;
+            if (victim == self) {
+                continue;
+            }
+            if (Job* job = workers[victim].deque.steal()) {
+                worker.stolen++;
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    // Frees the pool slot before running, so the owner can reuse it.
+    void execute(Worker& worker, Job* job) {
+        const JobFunction function = job->function;
+        void* data = job->data;
+        const u32 begin = job->begin;
+        const u32 end = job->end;
+        const u32 grain = job->grain;
+        JobCounter* counter = job->counter;
+        job->in_use.store(false, std::memory_order_release);
+        execute(worker, function, data, begin, end, grain, counter);
+    }
+
+    void execute(
+        Worker& worker,
+        JobFunction function,
+        void* data,
+        u32 begin,
+        u32 end,
+        u32 grain,
+        JobCounter* counter
+    ) {
+        // Split off the upper halves for thieves, keeping the lower one,
+        // until the range is small enough or the pool runs out.
+        while (grain > 0 && end - begin > grain) {
+            Job* half = allocate(worker);
+            if (!half) {
+                break;
+            }
+
+            const u32 middle = begin + (end - begin) / 2;
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+            fill(half, function, data, middle, end, grain, counter);
+            if (!worker.deque.push(half)) {
+                half->in_use.store(false, std::memory_order_relaxed);
+                counter->pending.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            wakeSleepers();
+            end = middle;
+        }
+
+        function(data, begin, end);
+        worker.executed++;
+        counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    static i32 workerMain(void* user_data) {
+        Worker& worker = *(Worker*)user_data;
+        JobSystem* system = worker.system;
+        current_job_worker = (i32)(&worker - system->workers);
+        tracer.nameThread("job");
+
+        i32 idle = 0;
+        while (!system->quit.load(std::memory_order_relaxed)) {
+            if (Job* job = system->findJob(worker)) {
+                system->execute(worker, job);
+                idle = 0;
+                continue;
+            }
+            if (++idle < SPIN_COUNT) {
+                SDL_CPUPauseInstruction();
+                continue;
+            }
+
+            // Announce the sleep, then look once more, so that a run()
+            // either sees a sleeper to wake or its job is found here.
+            const u32 seen = system->wake.load();
+            system->sleeping.fetch_add(1);
+            if (Job* job = system->findJob(worker)) {
+                system->sleeping.fetch_sub(1);
+                system->execute(worker, job);
+                idle = 0;
+                continue;
+            }
+            if (!system->quit.load()) {
+                system->wake.wait(seen);
+            }
+            system->sleeping.fetch_sub(1);
+            idle = 0;
+        }
+        return 0;
+    }
+};
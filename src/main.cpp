@@ -3,41 +3,403 @@
 #include <SDL3/SDL_opengl.h>
 #include <math.h>
 
-typedef uint8_t u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef int8_t i8;
-typedef int16_t i16;
-typedef int32_t i32;
-typedef int64_t i64;
-typedef float f32;
-typedef double f64;
-typedef size_t usize;
-
-const char* getShaderTypeName(GLenum type) {
-    switch(type) {
-        case GL_VERTEX_SHADER: return "VERTEX";
-        case GL_FRAGMENT_SHADER: return "FRAGMENT";
-        case GL_GEOMETRY_SHADER: return "GEOMETRY";
-        case GL_TESS_CONTROL_SHADER: return "TESSELLATION_CONTROL";
-        case GL_TESS_EVALUATION_SHADER: return "TESSELLATION_EVALUATION";
-        default: return nullptr;
-    }
-}
+#include "types.h"
+#include "command_queue.h"
+#include "compute_expansion.h"
+#include "frame_arena.h"
+#include "frame_capture.h"
+#include "frame_profiler.h"
+#include "gl_debug.h"
+#include "gl_lazy_loader.h"
+#include "gl_profiler.h"
+#include "gl_state.h"
+#include "gpu_culling.h"
+#include "gpu_trace.h"
+#include "headless.h"
+#include "image_diff.h"
+#include "image_io.h"
+#include "instances.h"
+#include "job_system.h"
+#include "multi_draw.h"
+#include "program_cache.h"
+#include "shader_compiler.h"
+#include "shader_reloader.h"
+#include "shader_variants.h"
+#include "simulation.h"
+#include "software_rasterizer.h"
+#include "stream_buffer.h"
+#include "trace.h"
+
+// A golden-image test: the frame render() produces at a fixed time.
+struct GoldenCase {
+    const char* name;
+    f64 time;
+    u32 instances;
+    bool animated;
+};
+
+// How render() turns triangles into points, if at all.
+enum PointExpansion {
+    EXPANSION_NONE,
+    EXPANSION_GEOMETRY, // geometry.glsl, in the main program
+    EXPANSION_COMPUTE,  // ComputeExpansion, ahead of an indirect draw
+};
 
 struct Application {
     SDL_Window* window = nullptr;
     SDL_GLContext gl_context = nullptr;
-    GLuint program;
+    HeadlessContext headless_context;
+    GLADloadproc gl_loader = nullptr;
+    bool gl_loaded = false;
+    GLuint program; // the variant render() last used
     GLuint vao;
     GLuint vbo;
+    GLuint instance_vbo = 0;
+    u32 instance_count = 0;
+    Instance* instance_base = nullptr;
+    StreamBuffer stream_buffer;
+    ComputeExpansion compute_expansion;
+    CommandQueue command_queue;
+    MultiDrawIndirect multi_draw;
+    GpuCulling gpu_culling;
+    SimulationThread simulation;
+    SoftwareRasterizer software_rasterizer;
+    ProgramCache program_cache;
+    ShaderCompiler shader_compiler;
+    ShaderVariants shader_variants;
+    ShaderReloader shader_reloader;
+    FrameProfiler frame_profiler;
+    FrameCapture frame_capture;
+    GLDebugContext gl_debug;
+    GLStateCache gl_state;
+    JobSystem jobs;
+    FrameArena frame_arena;
 
     bool running = true;
+    bool use_program_cache = true;
+    bool clear_program_cache = false;
+    bool bench_startup = false;
+    bool hot_reload = false;
+    const char* shader_directory = "src/shaders";
+    bool headless = false;
+    u64 frame_limit = 0;
+    const char* capture_path = nullptr;
+    const char* record_path = nullptr;
+    const char* golden_directory = nullptr;
+    bool update_golden = false;
+    u8 golden_tolerance = 2;
+    f64 golden_max_slowdown = 1.5;
+    i32 exit_code = 0;
+    bool benchmark = false;
+    const char* benchmark_path = "benchmark.json";
+    bool bench_instances = false;
+    bool animate_instances = false;
+    bool use_simulation_thread = true;
+    f64 simulation_rate = 60.0;
+    bool tessellation = false;
+    bool bench_tessellation = false;
+    f32 tess_level = 0.0f; // fixed level; 0 picks levels from edge length
+    f32 tess_pixels = 8.0f; // target on-screen length of an edge segment
+    PointExpansion expansion = EXPANSION_NONE;
+    bool bench_expansion = false;
+    bool bench_queue = false;
+    bool use_multi_draw = false;
+    bool multi_draw_count = false; // ARB_indirect_parameters, if available
+    bool bench_multi_draw = false;
+    bool culling = false;
+    bool bench_culling = false;
+    GLuint tess_uniform_program = 0;
+    GLint viewport_location = -1;
+    GLint pixels_per_segment_location = -1;
+    GLint fixed_level_location = -1;
+    bool software = false;
+    bool bench_software = false;
+    i32 thread_count = 0;
+    i32 job_threads = 0; // 0 uses every logical core
+    bool bench_jobs = false;
+    bool bench_arena = false;
+    const char* trace_path = nullptr;
+    u32 trace_events = Tracer::DEFAULT_EVENTS_PER_THREAD; // per thread
+    u32 gl_profile_interval = 0; // frames per GL call report; 0 is off
+    bool lazy_gl = false; // resolve GL entry points on first call
+    bool bench_gl_loader = false;
+#ifdef NDEBUG
+    bool gl_debug_output = false;
+#else
+    bool gl_debug_output = true;
+#endif
     i32 window_width = 800;
     i32 window_height = 600;
 
     bool initialize() {
+        // Before any thread starts, so that all of them are traced.
+        if (trace_path) {
+            tracer.initialize(trace_events);
+        }
+        TRACE_ZONE("initialize");
+
+        if (job_threads <= 0) {
+            job_threads = SDL_GetNumLogicalCPUCores();
+        }
+        if (!jobs.initialize(job_threads)) {
+            return false;
+        }
+        if (!frame_arena.initialize(1 << 20)) {
+            return false;
+        }
+        command_queue.initialize(&frame_arena);
+
+        if (software) {
+            return initializeSoftware();
+        }
+
+        if (headless) {
+            if (!headless_context.initialize(gl_debug_output)) {
+                return false;
+            }
+            gl_loader = HeadlessContext::loader();
+        } else if (!createWindow()) {
+            return false;
+        }
+
+        if (lazy_gl ? !gl_lazy_loader.load(gl_loader)
+                    : !gladLoadGLLoader(gl_loader)) {
+            SDL_Log("Failed to initialize GLAD");
+            return false;
+        }
+        gl_loaded = true;
+        gpu_tracer.initialize();
+
+        if (gl_debug_output) {
+            enableGLDebugOutput(&gl_debug);
+        }
+
+        const auto version = (const char*)(glGetString(GL_VERSION));
+        const auto renderer = (const char*)(glGetString(GL_RENDERER));
+        SDL_Log("OpenGL Version: %s", version);
+        SDL_Log("Renderer: %s", renderer);
+
+        if (headless) {
+            if (!headless_context.createFramebuffer(&gl_state, window_width,
+                                                    window_height)) {
+                return false;
+            }
+        } else {
+            // Benchmarks measure the renderer, not the display refresh rate.
+            SDL_GL_SetSwapInterval(benchmark ? 0 : 1);
+        }
+        gl_state.setViewport(0, 0, window_width, window_height);
+
+        // Recording keeps the size it started with; resizing the window
+        // while recording leaves the new area out of the capture.
+        if (record_path && !frame_capture.initialize(&gl_state, record_path,
+                                                     window_width,
+                                                     window_height, 60)) {
+            return false;
+        }
+
+        if (use_program_cache && program_cache.initialize() &&
+            clear_program_cache) {
+            program_cache.clear();
+        }
+
+        shader_compiler.initialize(
+            program_cache.enabled ? &program_cache : nullptr,
+            gl_loader
+        );
+
+        static constexpr u8 vs_source[] = {
+            #embed "shaders/vertex.glsl"
+        };
+
+        static constexpr u8 tcs_source[] = {
+            #embed "shaders/tessellation_control.glsl"
+        };
+
+        static constexpr u8 tes_source[] = {
+            #embed "shaders/tessellation_evaluation.glsl"
+        };
+
+        static constexpr u8 gs_source[] = {
+            #embed "shaders/geometry.glsl"
+        };
+
+        static constexpr u8 expand_source[] = {
+            #embed "shaders/expand_compute.glsl"
+        };
+
+        static constexpr u8 point_vs_source[] = {
+            #embed "shaders/point_vertex.glsl"
+        };
+
+        static constexpr u8 cull_source[] = {
+            #embed "shaders/cull_compute.glsl"
+        };
+
+        static constexpr u8 hiz_source[] = {
+            #embed "shaders/hiz_compute.glsl"
+        };
+
+        static constexpr u8 fs_source[] = {
+            #embed "shaders/fragment.glsl"
+        };
+
+        // Variants are compiled lazily, so the stage sources must stay alive.
+        const ShaderStage stage_sources[ShaderVariants::SOURCE_COUNT] = {
+            {GL_VERTEX_SHADER, "vertex.glsl", vs_source, sizeof(vs_source)},
+            {GL_TESS_CONTROL_SHADER, "tessellation_control.glsl",
+             tcs_source, sizeof(tcs_source)},
+            {GL_TESS_EVALUATION_SHADER, "tessellation_evaluation.glsl",
+             tes_source, sizeof(tes_source)},
+            {GL_GEOMETRY_SHADER, "geometry.glsl", gs_source, sizeof(gs_source)},
+            {GL_FRAGMENT_SHADER, "fragment.glsl", fs_source, sizeof(fs_source)},
+        };
+        shader_variants.initialize(&shader_compiler, stage_sources,
+                                   hot_reload);
+
+        const u32 startup_variant = programVariant();
+        ShaderStage stages[ShaderCompiler::MAX_STAGES];
+        const usize stage_count =
+            shader_variants.variantStages(startup_variant, stages);
+
+        if (bench_startup) {
+            benchmarkProgramBuild(stages, stage_count);
+            running = false;
+        }
+
+        // Everything below the request overlaps with the driver compiling
+        // the program; only get() waits for it. Other variants are built
+        // the first time render() asks for them.
+        shader_variants.request(startup_variant);
+
+        CompileHandle expand_job = -1, point_job = -1;
+        if (expansion == EXPANSION_COMPUTE || bench_expansion) {
+            const ShaderStage expand_stages[] = {
+                {GL_COMPUTE_SHADER, "expand_compute.glsl", expand_source,
+                 sizeof(expand_source)},
+            };
+            const ShaderStage point_stages[] = {
+                {GL_VERTEX_SHADER, "point_vertex.glsl", point_vs_source,
+                 sizeof(point_vs_source)},
+                stage_sources[ShaderVariants::SOURCE_FRAGMENT],
+            };
+            expand_job = shader_compiler.submit(expand_stages,
+                                                SDL_arraysize(expand_stages));
+            point_job = shader_compiler.submit(point_stages,
+                                               SDL_arraysize(point_stages));
+        }
+
+        CompileHandle cull_job = -1, hiz_job = -1;
+        if (culling || bench_culling) {
+            const ShaderStage cull_stages[] = {
+                {GL_COMPUTE_SHADER, "cull_compute.glsl", cull_source,
+                 sizeof(cull_source)},
+            };
+            const ShaderStage hiz_stages[] = {
+                {GL_COMPUTE_SHADER, "hiz_compute.glsl", hiz_source,
+                 sizeof(hiz_source)},
+            };
+            cull_job = shader_compiler.submit(cull_stages,
+                                              SDL_arraysize(cull_stages));
+            hiz_job = shader_compiler.submit(hiz_stages,
+                                             SDL_arraysize(hiz_stages));
+        }
+
+        if (benchmark) {
+            frame_profiler.initialize(frame_limit);
+        }
+
+        glCreateVertexArrays(1, &vao);
+        gl_state.bindVertexArray(vao);
+        gl_state.patchVertices(3);
+
+        if ((use_multi_draw || bench_multi_draw) &&
+            !multi_draw.initialize(&gl_state, gl_loader)) {
+            return false;
+        }
+
+        setDefaultInstanceAttribs();
+        if (instance_count > 0) {
+            createInstances(instance_count);
+        }
+
+        // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+        shader_compiler.finish();
+        program = shader_variants.get(startup_variant);
+        if (!program) {
+            return false;
+        }
+
+        if (expand_job >= 0 &&
+            !compute_expansion.initialize(&gl_state,
+                                          shader_compiler.take(expand_job),
+                                          shader_compiler.take(point_job))) {
+            return false;
+        }
+
+        if (cull_job >= 0 &&
+            !gpu_culling.initialize(&gl_state, shader_compiler.take(cull_job),
+                                    shader_compiler.take(hiz_job))) {
+            return false;
+        }
+
+        if (hot_reload) {
+            shader_reloader.initialize(shader_directory, &shader_variants);
+        }
+
+#ifndef NDEBUG
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR) {
+            SDL_Log("OpenGL initialization error: %d", error);
+            return false;
+        }
+#endif
+
+        SDL_Log("Shaders compiled and linked successfully");
+
+        // Only the frames are profiled, not the startup calls.
+        if (gl_profile_interval > 0) {
+            if (lazy_gl) {
+                gl_lazy_loader.resolveAll();
+            }
+            gl_profiler.enable(gl_profile_interval);
+        }
+
+        if (use_simulation_thread && !simulation.start(simulation_rate)) {
+            return false;
+        }
+
+        return true;
+    }
+
+    // The CPU rasterizer needs no window and no GL context at all.
+    bool initializeSoftware() {
+        if (thread_count <= 0) {
+            thread_count = SDL_GetNumLogicalCPUCores();
+        }
+
+        if (!software_rasterizer.initialize(window_width, window_height,
+                                            thread_count)) {
+            return false;
+        }
+
+        if (instance_count > 0) {
+            const auto instances =
+                (Instance*)SDL_malloc(sizeof(Instance) * instance_count);
+            generateInstances(instances, instance_count);
+            software_rasterizer.setInstances(instances, instance_count);
+            SDL_free(instances);
+        }
+
+        if (use_simulation_thread && !simulation.start(simulation_rate)) {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool createWindow() {
         if (!SDL_Init(SDL_INIT_VIDEO)) {
             SDL_Log("Failed to initialize SDL: %s", SDL_GetError());
             return false;
@@ -51,6 +413,12 @@ struct Application {
         );
         SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
         SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+        if (gl_debug_output) {
+            SDL_GL_SetAttribute(
+                SDL_GL_CONTEXT_FLAGS,
+                SDL_GL_CONTEXT_DEBUG_FLAG
+            );
+        }
 
         window = SDL_CreateWindow(
             "SDL3 OpenGL Application",
@@ -70,155 +438,1013 @@ struct Application {
             return false;
         }
 
-        if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
-            SDL_Log("Failed to initialize GLAD");
-            return false;
+        gl_loader = (GLADloadproc)SDL_GL_GetProcAddress;
+        return true;
+    }
+
+    // Synchronous build of a single program through the shader compiler.
+    // Returns 0 if any stage fails to compile or link.
+    GLuint buildProgram(const ShaderStage* stages, usize count) {
+        const auto job = shader_compiler.submit(stages, count);
+        if (job < 0) {
+            return 0;
         }
 
-        const auto version = (const char*)(glGetString(GL_VERSION));
-        const auto renderer = (const char*)(glGetString(GL_RENDERER));
-        SDL_Log("OpenGL Version: %s", version);
-        SDL_Log("Renderer: %s", renderer);
+        shader_compiler.finish();
+        return shader_compiler.take(job);
+    }
 
-        SDL_GL_SetSwapInterval(1);
-        glViewport(0, 0, window_width, window_height);
+    // Compares a full compile + link + cache store (cold launch) against
+    // linking from the cached binary (warm launch). Mesa only exposes program
+    // binaries while its own shader disk cache is on, so under llvmpipe
+    // (LIBGL_ALWAYS_SOFTWARE=1) point MESA_SHADER_CACHE_DIR at an empty
+    // directory to keep it from warming up the cold path across launches.
+    void benchmarkProgramBuild(const ShaderStage* stages, usize count) {
+        if (!program_cache.enabled) {
+            SDL_Log("Startup benchmark needs the program cache enabled");
+            return;
+        }
 
-        constexpr u8 vs_source[] = {
-            #embed "shaders/vertex.glsl"
+        constexpr i32 ITERATIONS = 20;
+        const auto key = program_cache.computeKey(stages, count);
+        const f64 ticks_per_ms = SDL_GetPerformanceFrequency() / 1000.0;
+
+        f64 cold_total = 0.0, cold_min = 1e9;
+        f64 warm_total = 0.0, warm_min = 1e9;
+
+        for (i32 i = 0; i < ITERATIONS; i++) {
+            program_cache.remove(key);
+
+            auto start = SDL_GetPerformanceCounter();
+            glDeleteProgram(buildProgram(stages, count));
+            glFinish();
+            const f64 cold =
+                (SDL_GetPerformanceCounter() - start) / ticks_per_ms;
+
+            start = SDL_GetPerformanceCounter();
+            glDeleteProgram(buildProgram(stages, count));
+            glFinish();
+            const f64 warm =
+                (SDL_GetPerformanceCounter() - start) / ticks_per_ms;
+
+            cold_total += cold;
+            cold_min = SDL_min(cold_min, cold);
+            warm_total += warm;
+            warm_min = SDL_min(warm_min, warm);
+        }
+
+        SDL_Log("Program build, %d iterations on %s", ITERATIONS,
+                (const char*)glGetString(GL_RENDERER));
+        SDL_Log("  cold (compile + link): avg %.3f ms, min %.3f ms",
+                cold_total / ITERATIONS, cold_min);
+        SDL_Log("  warm (program binary): avg %.3f ms, min %.3f ms",
+                warm_total / ITERATIONS, warm_min);
+    }
+
+    // (Re)creates `count` instances, copied from `data` or generated, and
+    // makes render() draw them with a single instanced call. Static
+    // instances live in an immutable buffer; animated ones are rewritten
+    // every frame into the stream buffer.
+    void createInstances(u32 count, const Instance* data = nullptr) {
+        destroyInstances();
+
+        const usize size = sizeof(Instance) * count;
+        const auto instances = (Instance*)SDL_malloc(size);
+        if (data) {
+            SDL_memcpy(instances, data, size);
+        } else {
+            generateInstances(instances, count);
+        }
+
+        if (animate_instances) {
+            if (!stream_buffer.initialize(size)) {
+                SDL_free(instances);
+                return;
+            }
+            instance_base = instances;
+            bindInstanceBuffer(vao, stream_buffer.buffer);
+        } else {
+            glCreateBuffers(1, &instance_vbo);
+            glNamedBufferStorage(instance_vbo, size, instances, 0);
+            SDL_free(instances);
+            bindInstanceBuffer(vao, instance_vbo);
+        }
+
+        instance_count = count;
+    }
+
+    void destroyInstances() {
+        if (instance_vbo || stream_buffer.buffer) {
+            unbindInstanceBuffer(vao);
+        }
+        if (instance_vbo) {
+            gl_state.deleteBuffer(&instance_vbo);
+        }
+        gl_state.forgetBuffer(stream_buffer.buffer);
+        stream_buffer.shutdown();
+        SDL_free(instance_base);
+        instance_base = nullptr;
+        instance_count = 0;
+    }
+
+    // The pre-instancing way of drawing many triangles, kept for comparison:
+    // one glDrawArrays per triangle with its data set as constant attributes.
+    void renderDrawLoop(const Instance* instances, u32 count, f64 currentTime) {
+        const f32 color[] = { 0.0f, 0.2f, 0.0f, 1.0f };
+        glClearBufferfv(GL_COLOR, 0, color);
+
+        program = shader_variants.get(programVariant());
+        gl_state.useProgram(program);
+
+        const auto state = evaluateSimulation(currentTime);
+        glVertexAttrib4fv(0, state.offset);
+
+        for (u32 i = 0; i < count; i++) {
+            glVertexAttrib4fv(1, instances[i].color);
+            glVertexAttrib4fv(2, instances[i].offset_scale);
+            glDrawArrays(primitiveMode(), 0, 3);
+        }
+
+        setDefaultInstanceAttribs();
+    }
+
+    // Sweeps the triangle count from 1 to 1M and compares one
+    // glDrawArraysInstanced against one glDrawArrays per triangle. The draw
+    // loop stops at 100k, where it is already far behind. Every step ends
+    // with glFinish, so the times cover both submission and GPU work.
+    void benchmarkInstancing() {
+        constexpr i32 FRAMES = 20;
+        constexpr u32 MAX_COUNT = 1000000;
+        constexpr u32 MAX_LOOP_COUNT = 100000;
+
+        const auto instances =
+            (Instance*)SDL_malloc(sizeof(Instance) * MAX_COUNT);
+        const u32 saved_count = instance_count;
+
+        SDL_Log("Instancing benchmark, %d frames per step on %s", FRAMES,
+                (const char*)glGetString(GL_RENDERER));
+        SDL_Log("%10s %18s %18s", "triangles", "instanced ms/frame",
+                "draw loop ms/frame");
+
+        for (u32 count = 1; count <= MAX_COUNT; count *= 10) {
+            createInstances(count);
+
+            glFinish();
+            auto start = SDL_GetPerformanceCounter();
+            for (i32 frame = 0; frame < FRAMES; frame++) {
+                render(frame / 60.0);
+                present();
+                frame_arena.endFrame();
+            }
+            glFinish();
+            const f64 instanced_ms =
+                ticksToMs(SDL_GetPerformanceCounter() - start) / FRAMES;
+
+            if (count > MAX_LOOP_COUNT) {
+                SDL_Log("%10u %18.3f %18s", count, instanced_ms, "-");
+                continue;
+            }
+
+            generateInstances(instances, count);
+            destroyInstances();
+
+            start = SDL_GetPerformanceCounter();
+            for (i32 frame = 0; frame < FRAMES; frame++) {
+                renderDrawLoop(instances, count, frame / 60.0);
+                present();
+            }
+            glFinish();
+            const f64 loop_ms =
+                ticksToMs(SDL_GetPerformanceCounter() - start) / FRAMES;
+
+            SDL_Log("%10u %18.3f %18.3f", count, instanced_ms, loop_ms);
+        }
+
+        SDL_free(instances);
+
+        if (saved_count > 0) {
+            createInstances(saved_count);
+        } else {
+            destroyInstances();
+        }
+    }
+
+    // Renders the same frames with 1, 2, 4, ... threads up to the number of
+    // logical cores and reports pixel and fragment throughput for each.
+    void benchmarkSoftware() {
+        constexpr i32 FRAMES = 100;
+        const i32 max_threads = SDL_max(thread_count, 1);
+        const f64 pixels = (f64)window_width * window_height;
+
+        SDL_Log("Software rasterizer benchmark, %dx%d, %u triangles, %d "
+                "frames per step",
+                window_width, window_height,
+                software_rasterizer.instance_count, FRAMES);
+        SDL_Log("%8s %12s %14s %16s", "threads", "ms/frame", "Mpixels/s",
+                "Mfragments/s");
+
+        for (i32 threads = 1;; threads = SDL_min(threads * 2, max_threads)) {
+            software_rasterizer.startWorkers(threads);
+            software_rasterizer.render(evaluateSimulation(0.0));
+
+            const u64 fragments_start = software_rasterizer.fragments;
+            const auto start = SDL_GetPerformanceCounter();
+            for (i32 frame = 0; frame < FRAMES; frame++) {
+                software_rasterizer.render(evaluateSimulation(frame / 60.0));
+            }
+            const f64 seconds =
+                ticksToMs(SDL_GetPerformanceCounter() - start) / 1000.0;
+            const u64 fragments =
+                software_rasterizer.fragments - fragments_start;
+
+            SDL_Log("%8d %12.3f %14.1f %16.1f", threads,
+                    seconds * 1000.0 / FRAMES,
+                    pixels * FRAMES / seconds / 1e6,
+                    fragments / seconds / 1e6);
+
+            if (threads == max_threads) {
+                break;
+            }
+        }
+
+        software_rasterizer.startWorkers(thread_count);
+    }
+
+    // Job system micro-benchmarks with 1, 2, 4, ... workers up to the number
+    // of logical cores: the cost of spawning and finishing an empty job, the
+    // cost per range of a parallelFor() over empty ranges, and the time and
+    // speedup of animating a large instance set with parallelFor().
+    void benchmarkJobs() {
+        constexpr u32 BATCH = 1024;
+        constexpr u32 BATCHES = 256;
+        constexpr u32 RANGES = 1 << 16;
+        constexpr u32 ANIMATED = 1 << 20;
+        constexpr u32 GRAIN = 4096;
+        constexpr i32 PASSES = 20;
+        const i32 max_threads = SDL_max(SDL_GetNumLogicalCPUCores(), 1);
+
+        const auto base = (Instance*)SDL_malloc(sizeof(Instance) * ANIMATED);
+        const auto out = (Instance*)SDL_malloc(sizeof(Instance) * ANIMATED);
+        if (!base || !out) {
+            SDL_Log("Failed to allocate %u instances", ANIMATED);
+            SDL_free(base);
+            SDL_free(out);
+            exit_code = 1;
+            return;
+        }
+        generateInstances(base, ANIMATED);
+
+        struct Animation {
+            Instance* out;
+            const Instance* base;
+            f64 time;
+        } animation = {out, base, 0.0};
+        const JobFunction empty = [](void*, u32, u32) {};
+        const JobFunction animate = [](void* data, u32 begin, u32 end) {
+            const auto animation = (Animation*)data;
+            animateInstances(animation->out, animation->base, begin, end,
+                             animation->time);
         };
 
-        const auto vs = compileShader(
-            (const GLchar*)vs_source,
-            sizeof(vs_source),
-            GL_VERTEX_SHADER
-        );
+        SDL_Log("Job system benchmark, %u empty jobs, %u empty ranges, %u "
+                "instances animated %d times",
+                BATCH * BATCHES, RANGES, ANIMATED, PASSES);
+        SDL_Log("%8s %12s %12s %12s %9s %10s", "threads", "ns/spawn",
+                "ns/range", "ms/animate", "speedup", "stolen");
 
-        // constexpr u8 tcs_source[] = {
-        //     #embed "shaders/tessellation_control.glsl"
-        // };
-        //
-        // const auto tcs = compileShader(
-        //     (const GLchar*)tcs_source,
-        //     sizeof(tcs_source),
-        //     GL_TESS_CONTROL_SHADER
-        // );
-        //
-        // constexpr u8 tes_source[] = {
-        //     #embed "shaders/tessellation_evaluation.glsl"
-        // };
-        //
-        // const auto tes = compileShader(
-        //     (const GLchar*)tes_source,
-        //     sizeof(tes_source),
-        //     GL_TESS_EVALUATION_SHADER
-        // );
-        //
-        // constexpr u8 gs_source[] = {
-        //     #embed "shaders/geometry.glsl"
-        // };
-        //
-        // const auto gs = compileShader(
-        //     (const GLchar*)gs_source,
-        //     sizeof(gs_source),
-        //     GL_GEOMETRY_SHADER
-        // );
-
-        constexpr u8 fs_source[] = {
-            #embed "shaders/fragment.glsl"
+        f64 single_ms = 0.0;
+        for (i32 threads = 1;; threads = SDL_min(threads * 2, max_threads)) {
+            jobs.initialize(threads);
+
+            // Spawned in batches so the pool never runs out.
+            auto start = SDL_GetPerformanceCounter();
+            for (u32 batch = 0; batch < BATCHES; batch++) {
+                JobCounter counter;
+                for (u32 i = 0; i < BATCH; i++) {
+                    jobs.run(empty, nullptr, 0, 1, 0, &counter);
+                }
+                jobs.wait(&counter);
+            }
+            const f64 spawn_ns = ticksToMs(SDL_GetPerformanceCounter() -
+                                           start) * 1e6 / (BATCH * BATCHES);
+
+            start = SDL_GetPerformanceCounter();
+            jobs.parallelFor(RANGES, 1, empty, nullptr);
+            const f64 range_ns =
+                ticksToMs(SDL_GetPerformanceCounter() - start) * 1e6 / RANGES;
+
+            jobs.parallelFor(ANIMATED, GRAIN, animate, &animation);
+            start = SDL_GetPerformanceCounter();
+            for (i32 pass = 0; pass < PASSES; pass++) {
+                animation.time = pass / 60.0;
+                jobs.parallelFor(ANIMATED, GRAIN, animate, &animation);
+            }
+            const f64 animate_ms =
+                ticksToMs(SDL_GetPerformanceCounter() - start) / PASSES;
+            if (threads == 1) {
+                single_ms = animate_ms;
+            }
+
+            u64 stolen = 0;
+            for (i32 i = 0; i < jobs.worker_count; i++) {
+                stolen += jobs.workers[i].stolen;
+            }
+
+            SDL_Log("%8d %12.1f %12.1f %12.3f %8.2fx %10llu", threads,
+                    spawn_ns, range_ns, animate_ms, single_ms / animate_ms,
+                    (unsigned long long)stolen);
+
+            if (threads == max_threads) {
+                break;
+            }
+        }
+
+        SDL_free(base);
+        SDL_free(out);
+        jobs.initialize(job_threads);
+    }
+
+    // Times loading every GL entry point with gladLoadGLLoader() against
+    // installing the lazy loader's trampolines, alone and together with
+    // resolving the entry points startup called, which --bench-gl-loader
+    // ran through the lazy loader to find out.
+    void benchmarkGLLoader() {
+        constexpr i32 ITERATIONS = 50;
+        const f64 ticks_per_ms = SDL_GetPerformanceFrequency() / 1000.0;
+
+        u32 startup[GL_FUNCTION_COUNT];
+        u32 startup_count = 0;
+        for (u32 i = 0; i < GL_FUNCTION_COUNT; i++) {
+            if (gl_lazy_loader.resolved[i]) {
+                startup[startup_count++] = i;
+            }
+        }
+
+        const auto elapsed_ms = [&](u64 start) {
+            return (SDL_GetPerformanceCounter() - start) / ticks_per_ms;
         };
 
-        const auto fs = compileShader(
-            (const GLchar*)fs_source,
-            sizeof(fs_source),
-            GL_FRAGMENT_SHADER
-        );
+        f64 eager_min = 1e9, install_min = 1e9, lazy_min = 1e9;
+        for (i32 i = 0; i < ITERATIONS; i++) {
+            auto start = SDL_GetPerformanceCounter();
+            gladLoadGLLoader(gl_loader);
+            const f64 eager_ms = elapsed_ms(start);
+            eager_min = SDL_min(eager_min, eager_ms);
 
-        program = glCreateProgram();
+            start = SDL_GetPerformanceCounter();
+            gl_lazy_loader.load(gl_loader);
+            const f64 install_ms = elapsed_ms(start);
+            install_min = SDL_min(install_min, install_ms);
 
-        glAttachShader(program, vs);
-        // glAttachShader(program, tcs);
-        // glAttachShader(program, tes);
-        // glAttachShader(program, gs);
-        glAttachShader(program, fs);
+            start = SDL_GetPerformanceCounter();
+            gl_lazy_loader.load(gl_loader);
+            for (u32 j = 0; j < startup_count; j++) {
+                gl_lazy_loader.resolve(startup[j]);
+            }
+            const f64 lazy_ms = elapsed_ms(start);
+            lazy_min = SDL_min(lazy_min, lazy_ms);
+        }
 
-        glLinkProgram(program);
+        SDL_Log("GL loader benchmark, %u entry points, %u called at startup, "
+                "best of %d loads",
+                (u32)GL_FUNCTION_COUNT, startup_count, ITERATIONS);
+        SDL_Log("  %-32s %8.3f ms", "eager", eager_min);
+        SDL_Log("  %-32s %8.3f ms", "lazy, trampolines only", install_min);
+        SDL_Log("  %-32s %8.3f ms (%.1fx faster)",
+                "lazy, startup's entry points", lazy_min,
+                eager_min / lazy_min);
+    }
 
-        if (!checkProgramLinking()) {
-            return false;
+    // Builds the same per-frame data with the frame arena, SDL_malloc and
+    // new: many small blocks, uniforms or per-draw data say, and a draw list
+    // grown one command at a time. The heap versions free everything at the
+    // end of the frame, as they would have to.
+    void benchmarkFrameArena() {
+        constexpr i32 FRAMES = 200;
+        constexpr u32 BLOCKS = 20000;
+        constexpr u32 DRAWS = 10000;
+        constexpr const char* NAMES[] = {"arena", "SDL_malloc", "new"};
+
+        const auto blocks = (u8**)SDL_malloc(sizeof(u8*) * BLOCKS);
+        u32 checksum = 0;
+        f64 arena_ms = 0.0;
+
+        SDL_Log("Frame arena benchmark, %u blocks of 16-256 bytes and a "
+                "%u-draw list per frame, %d frames",
+                BLOCKS, DRAWS, FRAMES);
+        SDL_Log("%12s %10s %10s", "allocator", "ms/frame", "vs arena");
+
+        for (u32 kind = 0; kind < SDL_arraysize(NAMES); kind++) {
+            frame_arena.initialize(1 << 20);
+
+            const auto start = SDL_GetPerformanceCounter();
+            for (i32 frame = 0; frame < FRAMES; frame++) {
+                u32 random = 0x9E3779B9;
+                for (u32 i = 0; i < BLOCKS; i++) {
+                    random = random * 1664525u + 1013904223u;
+                    const usize size = 16 + (random >> 24);
+                    if (kind == 0) {
+                        blocks[i] = (u8*)frame_arena.allocate(size);
+                    } else if (kind == 1) {
+                        blocks[i] = (u8*)SDL_malloc(size);
+                    } else {
+                        blocks[i] = new u8[size];
+                    }
+                    blocks[i][0] = (u8)i;
+                }
+
+                DrawCommand command = {};
+                if (kind == 0) {
+                    DrawCommand* draws = nullptr;
+                    u32 capacity = 0;
+                    for (u32 i = 0; i < DRAWS; i++) {
+                        if (i == capacity) {
+                            capacity = SDL_max(capacity * 2, 16u);
+                            draws = (DrawCommand*)frame_arena.reallocate(
+                                draws, sizeof(DrawCommand) * i,
+                                sizeof(DrawCommand) * capacity,
+                                alignof(DrawCommand)
+                            );
+                        }
+                        command.first = i;
+                        draws[i] = command;
+                    }
+                    checksum += draws[DRAWS / 2].first;
+                } else if (kind == 1) {
+                    DrawCommand* draws = nullptr;
+                    u32 capacity = 0;
+                    for (u32 i = 0; i < DRAWS; i++) {
+                        if (i == capacity) {
+                            capacity = SDL_max(capacity * 2, 16u);
+                            draws = (DrawCommand*)SDL_realloc(
+                                draws, sizeof(DrawCommand) * capacity
+                            );
+                        }
+                        command.first = i;
+                        draws[i] = command;
+                    }
+                    checksum += draws[DRAWS / 2].first;
+                    SDL_free(draws);
+                } else {
+                    DrawCommand* draws = nullptr;
+                    u32 capacity = 0;
+                    for (u32 i = 0; i < DRAWS; i++) {
+                        if (i == capacity) {
+                            capacity = SDL_max(capacity * 2, 16u);
+                            const auto grown = new DrawCommand[capacity];
+                            if (draws) {
+                                SDL_memcpy(grown, draws,
+                                           sizeof(DrawCommand) * i);
+                            }
+                            delete[] draws;
+                            draws = grown;
+                        }
+                        command.first = i;
+                        draws[i] = command;
+                    }
+                    checksum += draws[DRAWS / 2].first;
+                    delete[] draws;
+                }
+
+                for (u32 i = 0; i < BLOCKS; i++) {
+                    checksum += blocks[i][0];
+                    if (kind == 1) {
+                        SDL_free(blocks[i]);
+                    } else if (kind == 2) {
+                        delete[] blocks[i];
+                    }
+                }
+                if (kind == 0) {
+                    frame_arena.endFrame();
+                }
+            }
+            const f64 ms = ticksToMs(SDL_GetPerformanceCounter() - start);
+
+            if (kind == 0) {
+                arena_ms = ms;
+            }
+
+            SDL_Log("%12s %10.3f %9.2fx", NAMES[kind], ms / FRAMES,
+                    ms / arena_ms);
+            if (kind == 0) {
+                frame_arena.logTotals();
+            }
         }
 
-        glDeleteShader(vs);
-        // glDeleteShader(tcs);
-        // glDeleteShader(tes);
-        // glDeleteShader(gs);
-        glDeleteShader(fs);
+        SDL_Log("Checksum %u", checksum);
+        SDL_free(blocks);
+        frame_arena.initialize(1 << 20);
+    }
 
-        glCreateVertexArrays(1, &vao);
-        glBindVertexArray(vao);
+    // Renders each case at its fixed time and compares the frame with
+    // <dir>/<name>.ppm; --update-golden writes the references instead. A
+    // case fails when more than 0.1% of its pixels are outliers (see
+    // diffImages) or when its best frame time is over golden_max_slowdown
+    // times the reference time stored in <dir>/<name>.ms (0 turns the time
+    // check off, for noisy machines). The actual frame of a failing case is
+    // written next to the reference as <name>.actual.ppm.
+    void runGoldenTests() {
+        static constexpr GoldenCase CASES[] = {
+            {"triangle_t0", 0.0, 0, false},
+            {"triangle_t1", 1.0, 0, false},
+            {"triangle_t2_5", 2.5, 0, false},
+            {"instances_1k", 0.0, 1000, false},
+            {"instances_100k", 0.0, 100000, false},
+            {"instances_10k_animated_t1_5", 1.5, 10000, true},
+        };
+        constexpr i32 TIMED_FRAMES = 10;
+        constexpr f64 MAX_OUTLIERS = 0.001;
 
-        // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        if (!SDL_CreateDirectory(golden_directory)) {
+            SDL_Log("Failed to create %s: %s", golden_directory,
+                    SDL_GetError());
+            exit_code = 1;
+            return;
+        }
 
-        GLenum error = glGetError();
-        if (error != GL_NO_ERROR) {
-            SDL_Log("OpenGL initialization error: %d", error);
-            return false;
+        const usize pixel_count = (usize)window_width * window_height;
+        const auto pixels = (u8*)SDL_malloc(pixel_count * 4);
+        const u32 saved_count = instance_count;
+        const bool saved_animate = animate_instances;
+        i32 failed = 0;
+
+        SDL_Log("Golden images in %s on %s", golden_directory,
+                (const char*)glGetString(GL_RENDERER));
+        SDL_Log("%-28s %9s %9s %9s %9s %8s  %s", "case", "ms/frame", "ref ms",
+                "diff ms", "outliers", "PSNR", "result");
+
+        for (const auto& test : CASES) {
+            animate_instances = test.animated;
+            if (test.instances > 0) {
+                createInstances(test.instances);
+            } else {
+                destroyInstances();
+            }
+
+            // Best of several frames, after a warm-up one, is the least noisy
+            // measure of what the frame costs.
+            f64 frame_ms = 1e9;
+            for (i32 frame = 0; frame <= TIMED_FRAMES; frame++) {
+                const auto start = SDL_GetPerformanceCounter();
+                render(test.time);
+                glFinish();
+                const f64 ms = ticksToMs(SDL_GetPerformanceCounter() - start);
+                if (frame > 0) {
+                    frame_ms = SDL_min(frame_ms, ms);
+                }
+                frame_arena.endFrame();
+            }
+            headless_context.readPixels(pixels);
+
+            char image_path[1024];
+            char timing_path[1024];
+            SDL_snprintf(image_path, sizeof(image_path), "%s/%s.ppm",
+                         golden_directory, test.name);
+            SDL_snprintf(timing_path, sizeof(timing_path), "%s/%s.ms",
+                         golden_directory, test.name);
+
+            if (update_golden) {
+                char timing[32];
+                const i32 length =
+                    SDL_snprintf(timing, sizeof(timing), "%.4f\n", frame_ms);
+                const bool written =
+                    writePPM(image_path, window_width, window_height, pixels,
+                             true) &&
+                    SDL_SaveFile(timing_path, timing, length);
+                failed += !written;
+                SDL_Log("%-28s %9.3f %9s %9s %9s %8s  %s", test.name,
+                        frame_ms, "-", "-", "-", "-",
+                        written ? "updated" : "FAILED");
+                continue;
+            }
+
+            i32 ref_width = 0, ref_height = 0;
+            const auto reference =
+                readPPM(image_path, &ref_width, &ref_height, true);
+            if (!reference || ref_width != window_width ||
+                ref_height != window_height) {
+                SDL_Log("%-28s %9.3f %9s %9s %9s %8s  %s", test.name,
+                        frame_ms, "-", "-", "-", "-", "FAILED (no reference)");
+                SDL_free(reference);
+                failed++;
+                continue;
+            }
+
+            const auto diff_start = SDL_GetPerformanceCounter();
+            const auto diff = diffImages(pixels, reference, pixel_count,
+                                         golden_tolerance);
+            const f64 diff_ms =
+                ticksToMs(SDL_GetPerformanceCounter() - diff_start);
+            SDL_free(reference);
+
+            f64 reference_ms = 0.0;
+            if (const auto timing = (char*)SDL_LoadFile(timing_path, nullptr)) {
+                reference_ms = SDL_atof(timing);
+                SDL_free(timing);
+            }
+
+            const bool image_ok = diff.outliers <= MAX_OUTLIERS * pixel_count;
+            const bool time_ok = golden_max_slowdown <= 0.0 ||
+                                 reference_ms <= 0.0 ||
+                                 frame_ms <= reference_ms * golden_max_slowdown;
+            if (!image_ok) {
+                SDL_snprintf(image_path, sizeof(image_path),
+                             "%s/%s.actual.ppm", golden_directory, test.name);
+                writePPM(image_path, window_width, window_height, pixels,
+                         true);
+            }
+            failed += !(image_ok && time_ok);
+
+            SDL_Log("%-28s %9.3f %9.3f %9.3f %9llu %8.2f  %s", test.name,
+                    frame_ms, reference_ms, diff_ms,
+                    (unsigned long long)diff.outliers, diff.psnr,
+                    !image_ok ? "FAILED (image)"
+                    : !time_ok ? "FAILED (slower)"
+                               : "ok");
         }
 
-        SDL_Log("Shaders compiled and linked successfully");
+        SDL_free(pixels);
+        animate_instances = saved_animate;
+        if (saved_count > 0) {
+            createInstances(saved_count);
+        } else {
+            destroyInstances();
+        }
 
-        return true;
+        SDL_Log("%d of %d golden cases failed", failed,
+                (i32)SDL_arraysize(CASES));
+        exit_code = failed ? 1 : 0;
     }
 
-    GLuint compileShader(
-        const GLchar* code,
-        const GLint code_len,
-        const GLenum shader_type
-    ) {
-        const auto shader = glCreateShader(shader_type);
-        glShaderSource(shader, 1, &code, &code_len);
-        glCompileShader(shader);
-        
-        const auto type_name = getShaderTypeName(shader_type);
+    // Draws the same scenes with the level fixed at 5, what the control
+    // shader used to hardcode, and with adaptive levels. Primitives are
+    // what the tessellator emits, from a GL_PRIMITIVES_GENERATED query, and
+    // both columns are per frame.
+    void benchmarkTessellation() {
+        constexpr i32 FRAMES = 20;
+        constexpr u32 COUNTS[] = {1, 100, 10000};
+        constexpr f32 FIXED_LEVEL = 5.0f;
 
-        if (!type_name || !checkShaderCompilation(shader, type_name)) {
-            return 0;
+        const f32 saved_level = tess_level;
+        const u32 saved_count = instance_count;
+
+        GLuint query;
+        glCreateQueries(GL_PRIMITIVES_GENERATED, 1, &query);
+
+        SDL_Log("Tessellation benchmark, %d frames per step, %.1f px per "
+                "segment, on %s",
+                FRAMES, tess_pixels, (const char*)glGetString(GL_RENDERER));
+        SDL_Log("%10s %14s %10s %14s %10s", "triangles", "fixed prims",
+                "fixed ms", "adaptive prims", "adapt. ms");
+
+        for (const u32 count : COUNTS) {
+            createInstances(count);
+
+            GLuint64 primitives[2];
+            f64 frame_ms[2];
+            for (i32 mode = 0; mode < 2; mode++) {
+                tess_level = mode == 0 ? FIXED_LEVEL : 0.0f;
+
+                render(0.0);
+                frame_arena.endFrame();
+                glFinish();
+
+                const auto start = SDL_GetPerformanceCounter();
+                glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+                for (i32 frame = 0; frame < FRAMES; frame++) {
+                    render(frame / 60.0);
+                    present();
+                    frame_arena.endFrame();
+                }
+                glEndQuery(GL_PRIMITIVES_GENERATED);
+                glFinish();
+                frame_ms[mode] =
+                    ticksToMs(SDL_GetPerformanceCounter() - start) / FRAMES;
+
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT,
+                                      &primitives[mode]);
+                primitives[mode] /= FRAMES;
+            }
+
+            SDL_Log("%10u %14llu %10.3f %14llu %10.3f", count,
+                    (unsigned long long)primitives[0], frame_ms[0],
+                    (unsigned long long)primitives[1], frame_ms[1]);
         }
 
-        return shader;
+        glDeleteQueries(1, &query);
+        tess_level = saved_level;
+        if (saved_count > 0) {
+            createInstances(saved_count);
+        } else {
+            destroyInstances();
+        }
     }
 
-    bool checkShaderCompilation(GLuint shader, const char* type) {
-        GLint success;
-        GLchar log_msg[1024];
+    // Expands 1 to 1M triangles into points with geometry.glsl and with the
+    // compute pass, timing both with glFinish at the end of each step.
+    void benchmarkExpansion() {
+        constexpr i32 FRAMES = 20;
+        constexpr u32 MAX_COUNT = 1000000;
 
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        const PointExpansion saved_expansion = expansion;
+        const u32 saved_count = instance_count;
 
-        if (!success) {
-            glGetShaderInfoLog(shader, sizeof(log_msg), nullptr, log_msg);
-            SDL_Log("ERROR::SHADER_COMPILATION_ERROR of type: %s\n%s", type,
-                    log_msg);
-            return false;
+        SDL_Log("Point expansion benchmark, %d frames per step on %s", FRAMES,
+                (const char*)glGetString(GL_RENDERER));
+        SDL_Log("%10s %16s %16s", "triangles", "geometry ms", "compute ms");
+
+        for (u32 count = 1; count <= MAX_COUNT; count *= 10) {
+            createInstances(count);
+
+            f64 frame_ms[2];
+            for (i32 path = 0; path < 2; path++) {
+                expansion = path == 0 ? EXPANSION_GEOMETRY : EXPANSION_COMPUTE;
+
+                render(0.0);
+                frame_arena.endFrame();
+                glFinish();
+
+                const auto start = SDL_GetPerformanceCounter();
+                for (i32 frame = 0; frame < FRAMES; frame++) {
+                    render(frame / 60.0);
+                    present();
+                    frame_arena.endFrame();
+                }
+                glFinish();
+                frame_ms[path] =
+                    ticksToMs(SDL_GetPerformanceCounter() - start) / FRAMES;
+            }
+
+            SDL_Log("%10u %16.3f %16.3f", count, frame_ms[0], frame_ms[1]);
         }
 
-        return true;
+        expansion = saved_expansion;
+        if (saved_count > 0) {
+            createInstances(saved_count);
+        } else {
+            destroyInstances();
+        }
     }
 
-    bool checkProgramLinking() {
-        GLint success;
-        GLchar log_msg[1024];
+    // Submits 100k single-triangle draws to the command queue in random
+    // program and material order (two programs, 256 materials, the
+    // triangle's y standing in for depth) and dispatches them once in
+    // submission order and once radix-sorted. Reports the CPU time of
+    // submitting, sorting and dispatching, the frame time up to glFinish,
+    // and how often the program and material changed per frame.
+    void benchmarkCommandQueue() {
+        constexpr i32 FRAMES = 20;
+        constexpr u32 DRAWS = 100000;
+        constexpr u32 MATERIALS = 256;
 
-        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        const u32 variants[] = {0, VARIANT_GEOMETRY};
+        GLuint programs[SDL_arraysize(variants)];
+        for (usize i = 0; i < SDL_arraysize(variants); i++) {
+            programs[i] = shader_variants.get(variants[i]);
+        }
 
-        if (!success) {
-            glGetProgramInfoLog(program, sizeof(log_msg), nullptr, log_msg);
-            SDL_Log("ERROR::PROGRAM_LINKING_ERROR\n%s", log_msg);
-            return false;
+        // Non-instanced draws need the instance arrays disabled.
+        const u32 saved_count = instance_count;
+        destroyInstances();
+
+        const auto instances = (Instance*)SDL_malloc(sizeof(Instance) * DRAWS);
+        generateInstances(instances, DRAWS);
+
+        SDL_Log("Command queue benchmark, %u draws, %d frames per order on %s",
+                DRAWS, FRAMES, (const char*)glGetString(GL_RENDERER));
+        SDL_Log("%10s %10s %10s %12s %10s %9s %10s", "order", "submit ms",
+                "sort ms", "dispatch ms", "frame ms", "programs",
+                "materials");
+
+        for (i32 sorted = 0; sorted < 2; sorted++) {
+            f64 submit_ms = 0.0, sort_ms = 0.0, dispatch_ms = 0.0;
+
+            glFinish();
+            const auto start = SDL_GetPerformanceCounter();
+            for (i32 frame = 0; frame < FRAMES; frame++) {
+                const auto state = evaluateSimulation(frame / 60.0);
+
+                const auto submit_start = SDL_GetPerformanceCounter();
+                command_queue.reset();
+                u32 random = 0x9E3779B9;
+                for (u32 i = 0; i < DRAWS; i++) {
+                    random = random * 1664525u + 1013904223u;
+                    const u32 program_index = random >> 31;
+                    const u32 material = (random >> 8) % MATERIALS;
+                    const f32 depth = instances[i].offset_scale[1] * 0.5f +
+                                      0.5f;
+
+                    const auto command = command_queue.submit(makeSortKey(
+                        PASS_OPAQUE, variants[program_index], material,
+                        quantizeDepth(depth, false)
+                    ));
+                    if (!command) {
+                        break;
+                    }
+                    *command = {programs[program_index], vao, GL_TRIANGLES,
+                                DRAW_ARRAYS, 0, 3, 0, 0, 0, 0, instances[i]};
+                    SDL_memcpy(command->instance.color,
+                               instances[material].color,
+                               sizeof(command->instance.color));
+                }
+
+                const auto sort_start = SDL_GetPerformanceCounter();
+                if (sorted) {
+                    command_queue.sort();
+                }
+
+                const auto dispatch_start = SDL_GetPerformanceCounter();
+                const f32 color[] = { 0.0f, 0.2f, 0.0f, 1.0f };
+                glClearBufferfv(GL_COLOR, 0, color);
+                glVertexAttrib4fv(0, state.offset);
+                command_queue.dispatch(&gl_state, &multi_draw);
+                const auto dispatch_end = SDL_GetPerformanceCounter();
+
+                present();
+                frame_arena.endFrame();
+
+                submit_ms += ticksToMs(sort_start - submit_start);
+                sort_ms += ticksToMs(dispatch_start - sort_start);
+                dispatch_ms += ticksToMs(dispatch_end - dispatch_start);
+            }
+            glFinish();
+            const f64 frame_ms =
+                ticksToMs(SDL_GetPerformanceCounter() - start) / FRAMES;
+
+            SDL_Log("%10s %10.3f %10.3f %12.3f %10.3f %9u %10u",
+                    sorted ? "sorted" : "submitted", submit_ms / FRAMES,
+                    sort_ms / FRAMES, dispatch_ms / FRAMES, frame_ms,
+                    command_queue.program_changes,
+                    command_queue.material_changes);
         }
 
-        return true;
+        SDL_free(instances);
+        setDefaultInstanceAttribs();
+
+        if (saved_count > 0) {
+            createInstances(saved_count);
+        }
+    }
+
+    // Sweeps the triangle count from 1 to 1M and draws every triangle as
+    // its own draw: one glDrawArrays each (up to 100k), one
+    // glMultiDrawArraysIndirect for all of them, and its count variant when
+    // ARB_indirect_parameters is available. Reports the CPU time spent in
+    // render() and the frame time up to glFinish.
+    void benchmarkMultiDraw() {
+        constexpr i32 FRAMES = 20;
+        constexpr u32 MAX_COUNT = 1000000;
+        constexpr u32 MAX_LOOP_COUNT = 100000;
+
+        const bool saved_multi_draw = use_multi_draw;
+        const bool saved_count_variant = multi_draw_count;
+        const u32 saved_count = instance_count;
+        const auto instances =
+            (Instance*)SDL_malloc(sizeof(Instance) * MAX_COUNT);
+
+        SDL_Log("Multi-draw benchmark, %d frames per step on %s", FRAMES,
+                (const char*)glGetString(GL_RENDERER));
+        SDL_Log("%10s %21s %21s %21s", "triangles", "draw loop cpu/frame",
+                "multi-draw cpu/frame", "count cpu/frame");
+
+        for (u32 count = 1; count <= MAX_COUNT; count *= 10) {
+            // 0: draw loop, 1: multi-draw, 2: multi-draw count.
+            f64 cpu_ms[3] = {}, frame_ms[3] = {};
+            bool measured[3] = {};
+
+            for (i32 path = 0; path < 3; path++) {
+                if ((path == 0 && count > MAX_LOOP_COUNT) ||
+                    (path == 2 && !multi_draw.multiDrawArraysIndirectCount)) {
+                    continue;
+                }
+
+                if (path == 0) {
+                    generateInstances(instances, count);
+                    destroyInstances();
+                } else {
+                    use_multi_draw = true;
+                    multi_draw_count = path == 2;
+                    if (instance_count != count) {
+                        createInstances(count);
+                    }
+                    render(0.0);
+                    frame_arena.endFrame();
+                }
+                glFinish();
+
+                u64 cpu_ticks = 0;
+                const auto start = SDL_GetPerformanceCounter();
+                for (i32 frame = 0; frame < FRAMES; frame++) {
+                    const auto render_start = SDL_GetPerformanceCounter();
+                    if (path == 0) {
+                        renderDrawLoop(instances, count, frame / 60.0);
+                    } else {
+                        render(frame / 60.0);
+                    }
+                    cpu_ticks += SDL_GetPerformanceCounter() - render_start;
+                    present();
+                    frame_arena.endFrame();
+                }
+                glFinish();
+
+                cpu_ms[path] = ticksToMs(cpu_ticks) / FRAMES;
+                frame_ms[path] =
+                    ticksToMs(SDL_GetPerformanceCounter() - start) / FRAMES;
+                measured[path] = true;
+            }
+
+            char columns[3][32];
+            for (i32 path = 0; path < 3; path++) {
+                if (measured[path]) {
+                    SDL_snprintf(columns[path], sizeof(columns[path]),
+                                 "%9.3f/%9.3f", cpu_ms[path], frame_ms[path]);
+                } else {
+                    SDL_strlcpy(columns[path], "-", sizeof(columns[path]));
+                }
+            }
+            SDL_Log("%10u %21s %21s %21s", count, columns[0], columns[1],
+                    columns[2]);
+        }
+
+        SDL_free(instances);
+        use_multi_draw = saved_multi_draw;
+        multi_draw_count = saved_count_variant;
+        if (saved_count > 0) {
+            createInstances(saved_count);
+        } else {
+            destroyInstances();
+        }
+    }
+
+    // Draws generateOccludedInstances() scenes of 10k to 1M triangles
+    // without culling, with frustum culling only and with frustum and Hi-Z
+    // occlusion culling, and reports the frame time (up to glFinish) and
+    // how many triangles each draws.
+    void benchmarkCulling() {
+        constexpr i32 FRAMES = 20;
+        constexpr u32 MIN_COUNT = 10000;
+        constexpr u32 MAX_COUNT = 1000000;
+
+        const bool saved_culling = culling;
+        const bool saved_occlusion = gpu_culling.occlusion;
+        const u32 saved_count = instance_count;
+        const auto instances =
+            (Instance*)SDL_malloc(sizeof(Instance) * MAX_COUNT);
+
+        SDL_Log("Culling benchmark, %d frames per step on %s", FRAMES,
+                (const char*)glGetString(GL_RENDERER));
+        SDL_Log("%10s %12s %22s %22s", "triangles", "none ms",
+                "frustum ms / drawn", "occlusion ms / drawn");
+
+        for (u32 count = MIN_COUNT; count <= MAX_COUNT; count *= 10) {
+            generateOccludedInstances(instances, count);
+            createInstances(count, instances);
+
+            // 0: no culling, 1: frustum, 2: frustum and occlusion.
+            f64 frame_ms[3];
+            u32 drawn[3];
+            for (i32 path = 0; path < 3; path++) {
+                culling = path > 0;
+                gpu_culling.occlusion = path == 2;
+                gpu_culling.has_pyramid = false;
+
+                // Also builds the pyramid the first timed frame tests.
+                render(0.0);
+                frame_arena.endFrame();
+                glFinish();
+
+                const auto start = SDL_GetPerformanceCounter();
+                for (i32 frame = 0; frame < FRAMES; frame++) {
+                    render(frame / 60.0);
+                    present();
+                    frame_arena.endFrame();
+                }
+                glFinish();
+
+                frame_ms[path] =
+                    ticksToMs(SDL_GetPerformanceCounter() - start) / FRAMES;
+                drawn[path] = culling ? gpu_culling.readVisibleCount()
+                                      : count;
+            }
+
+            SDL_Log("%10u %12.3f %12.3f / %7u %12.3f / %7u", count,
+                    frame_ms[0], frame_ms[1], drawn[1], frame_ms[2],
+                    drawn[2]);
+        }
+
+        SDL_free(instances);
+        culling = saved_culling;
+        gpu_culling.occlusion = saved_occlusion;
+        gpu_culling.has_pyramid = false;
+        if (saved_count > 0) {
+            createInstances(saved_count);
+        } else {
+            destroyInstances();
+        }
     }
 
     void handleEvents() {
+        TRACE_ZONE("handleEvents");
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             switch (event.type) {
@@ -228,7 +1454,7 @@ struct Application {
             case SDL_EVENT_WINDOW_RESIZED:
                 window_width = event.window.data1;
                 window_height = event.window.data2;
-                glViewport(0, 0, window_width, window_height);
+                gl_state.setViewport(0, 0, window_width, window_height);
                 break;
             case SDL_EVENT_KEY_DOWN:
                 if (event.key.key == SDLK_ESCAPE) {
@@ -240,40 +1466,427 @@ struct Application {
     }
 
     void render(f64 currentTime) {
+        render(evaluateSimulation(currentTime));
+    }
+
+    void render(const SimulationState& state) {
+        TRACE_ZONE("render");
+        if (software) {
+            software_rasterizer.render(state);
+            return;
+        }
+        TRACE_GPU_ZONE("render");
+
         const f32 color[] = { 0.0f, 0.2f, 0.0f, 1.0f };
         glClearBufferfv(GL_COLOR, 0, color);
 
-        glUseProgram(program);
+        // Occlusion culling needs a depth buffer to build its pyramid from.
+        gl_state.setEnabled(GL_DEPTH_TEST, culling);
+        if (culling) {
+            const f32 clear_depth = 1.0f;
+            glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+            gl_state.depthFunc(GL_LEQUAL);
+        }
+
+        // The paths below only run their compute passes and submit their
+        // draws; one dispatch() issues the frame.
+        command_queue.reset();
+        glVertexAttrib4fv(0, state.offset);
 
-        // glPointSize(5.0);
-        
-        GLfloat offset[] = { 
-            (float)sin(currentTime) * 0.5f,
-            (float)cos(currentTime) * 0.6f,
-            0.0f,
-            0.0f
-        };
-        glVertexAttrib4fv(0, offset);
+        GLuint instances = instance_vbo;
+        GLintptr instance_offset = 0;
+        bool have_instances = true;
+        const bool streamed = instance_count > 0 && instance_base;
+        if (streamed) {
+            stream_buffer.beginFrame();
+            have_instances = streamInstances(state.time, &instance_offset);
+            instances = stream_buffer.buffer;
+        }
+
+        if (have_instances) {
+            if (expansion == EXPANSION_COMPUTE) {
+                submitComputeExpansion(instances, instance_offset,
+                                       state.offset);
+            } else {
+                submitDraw(instances, instance_offset, state.offset);
+            }
+        }
 
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        command_queue.sort();
+        command_queue.dispatch(&gl_state, &multi_draw);
 
-        GLenum error = glGetError();
-        if (error != GL_NO_ERROR) {
-            SDL_Log("OpenGL render error: %d at frame: %f", error, currentTime);
+        if (streamed) {
+            stream_buffer.endFrame();
+        }
+
+        if (culling && expansion != EXPANSION_COMPUTE) {
+            TRACE_GPU_ZONE("hi-z pyramid");
+            gpu_culling.buildPyramid(headless ? headless_context.fbo : 0,
+                                     window_width, window_height);
+        }
+    }
+
+    // Submits the frame's one draw, of the instances in `instances` at
+    // `offset`: a multi-draw with one draw per instance, an indirect draw
+    // of those that survive culling, or a single instanced draw. Without
+    // instances, the single triangle.
+    void submitDraw(
+        GLuint instances,
+        GLintptr offset,
+        const f32* global_offset
+    ) {
+        program = shader_variants.get(programVariant());
+        if (tessellation) {
+            setTessellationUniforms();
+        }
+        const GLenum mode = primitiveMode();
+
+        if (instance_count > 0 && !use_multi_draw && culling) {
+            TRACE_GPU_ZONE("cull");
+            gpu_culling.cull(instances, offset, instance_count,
+                             global_offset);
+        }
+
+        if (instance_count > 0 && use_multi_draw &&
+            !multi_draw.setDraws(instance_count, 3, &frame_arena)) {
+            return;
+        }
+
+        DrawCommand* draw = command_queue.submit(
+            makeSortKey(PASS_OPAQUE, programVariant(), 0, 0)
+        );
+        if (!draw) {
+            return;
+        }
+
+        if (instance_count > 0 && use_multi_draw) {
+            *draw = {program, vao, mode,
+                     multi_draw_count ? DRAW_MULTI_INDIRECT_COUNT
+                                      : DRAW_MULTI_INDIRECT,
+                     0, 3, (GLsizei)instance_count, instances, offset, 0,
+                     DEFAULT_INSTANCE};
+        } else if (instance_count > 0 && culling) {
+            *draw = gpu_culling.drawCommand(mode, program, vao);
+        } else if (instance_count > 0) {
+            *draw = {program, vao, mode, DRAW_ARRAYS, 0, 3,
+                     (GLsizei)instance_count, instances, offset, 0,
+                     DEFAULT_INSTANCE};
+        } else {
+            *draw = {program, vao, mode, DRAW_ARRAYS, 0, 3, 0, 0, 0, 0,
+                     DEFAULT_INSTANCE};
+        }
+    }
+
+    // Writes this frame's animated instances into the stream buffer.
+    bool streamInstances(f64 time, GLintptr* offset) {
+        const auto instances = (Instance*)stream_buffer.allocate(
+            sizeof(Instance) * instance_count,
+            alignof(Instance),
+            offset
+        );
+        if (!instances) {
+            return false;
+        }
+
+        // Instances move independently, so ranges go to the job workers.
+        struct Animation {
+            Instance* out;
+            const Instance* base;
+            f64 time;
+        } animation = {instances, instance_base, time};
+
+        constexpr u32 GRAIN = 4096;
+        jobs.parallelFor(instance_count, GRAIN,
+                         [](void* data, u32 begin, u32 end) {
+            TRACE_ZONE("animate instances");
+            const auto animation = (Animation*)data;
+            animateInstances(animation->out, animation->base, begin, end,
+                             animation->time);
+        }, &animation);
+        return true;
+    }
+
+    // Expands the instances, or the single triangle when there are none,
+    // and submits the draw of the points.
+    void submitComputeExpansion(
+        GLuint instances,
+        GLintptr offset,
+        const f32* global_offset
+    ) {
+        compute_expansion.expand(instances, offset, instance_count,
+                                 global_offset);
+
+        DrawCommand* draw =
+            command_queue.submit(makeSortKey(PASS_OPAQUE, 0, 0, 0));
+        if (draw) {
+            *draw = compute_expansion.drawCommand(vao);
+        }
+    }
+
+    // Which program variant the current settings draw with.
+    u32 programVariant() const {
+        u32 bits = 0;
+        if (tessellation) {
+            bits |= VARIANT_TESSELLATION;
+            if (tess_level > 0.0f) {
+                bits |= VARIANT_FIXED_TESS_LEVEL;
+            }
+        }
+        if (expansion == EXPANSION_GEOMETRY) {
+            bits |= VARIANT_GEOMETRY;
+        }
+        // The single triangle has no per-draw data to read.
+        if (use_multi_draw && instance_count > 0) {
+            bits |= VARIANT_MULTI_DRAW;
+        }
+        return bits;
+    }
+
+    GLenum primitiveMode() const {
+        return tessellation ? GL_PATCHES : GL_TRIANGLES;
+    }
+
+    void setTessellationUniforms() {
+        // Hot reload can swap in a program with different locations.
+        if (tess_uniform_program != program) {
+            tess_uniform_program = program;
+            viewport_location = glGetUniformLocation(program, "viewport");
+            pixels_per_segment_location =
+                glGetUniformLocation(program, "pixels_per_segment");
+            fixed_level_location =
+                glGetUniformLocation(program, "fixed_level");
+        }
+
+        glProgramUniform2f(program, viewport_location, (f32)window_width,
+                           (f32)window_height);
+        glProgramUniform1f(program, pixels_per_segment_location, tess_pixels);
+        glProgramUniform1f(program, fixed_level_location, tess_level);
+    }
+
+    void present() {
+        if (software) {
+            return;
+        }
+
+        TRACE_ZONE("swap");
+        TRACE_GPU_ZONE("swap");
+
+        if (headless) {
+            headless_context.present();
+        } else {
+            SDL_GL_SwapWindow(window);
         }
     }
 
     void run() {
+        if (bench_instances) {
+            benchmarkInstancing();
+            return;
+        }
+
+        if (bench_expansion) {
+            benchmarkExpansion();
+            return;
+        }
+
+        if (bench_tessellation) {
+            benchmarkTessellation();
+            return;
+        }
+
+        if (bench_software) {
+            benchmarkSoftware();
+            return;
+        }
+
+        if (bench_queue) {
+            benchmarkCommandQueue();
+            return;
+        }
+
+        if (bench_multi_draw) {
+            benchmarkMultiDraw();
+            return;
+        }
+
+        if (bench_culling) {
+            benchmarkCulling();
+            return;
+        }
+
+        if (bench_jobs) {
+            benchmarkJobs();
+            return;
+        }
+
+        if (bench_arena) {
+            benchmarkFrameArena();
+            return;
+        }
+
+        if (bench_gl_loader) {
+            benchmarkGLLoader();
+            return;
+        }
+
+        if (golden_directory) {
+            runGoldenTests();
+            return;
+        }
+
+        const auto start = SDL_GetPerformanceCounter();
+        auto frame_start = start;
+        u64 frame_count = 0;
+
         while (running) {
-            handleEvents();
-            render(SDL_GetTicks() / 1000.0);
-            SDL_GL_SwapWindow(window);
+            TRACE_ZONE("frame");
+            if (!headless && !software) {
+                handleEvents();
+            }
+            gl_state.beginFrame();
+            gl_debug.setFrame(frame_count);
+            gl_debug.setSite("hot reload");
+            shader_reloader.update();
+
+            if (benchmark) {
+                frame_profiler.beginGpu();
+            }
+            gl_debug.setSite("render");
+            if (simulation.thread) {
+                render(simulation.sample(SDL_GetTicksNS()));
+            } else {
+                render(SDL_GetTicks() / 1000.0);
+            }
+            if (benchmark) {
+                frame_profiler.endGpu();
+            }
+
+            if (record_path) {
+                gl_debug.setSite("capture");
+                frame_capture.capture(headless ? headless_context.fbo : 0,
+                                      frame_count);
+            }
+
+            const auto swap_start = SDL_GetPerformanceCounter();
+            gl_debug.setSite("present");
+            present();
+            const auto frame_end = SDL_GetPerformanceCounter();
+
+            if (record_path) {
+                frame_capture.poll(false);
+            }
+
+            if (benchmark) {
+                frame_profiler.endFrame(
+                    ticksToMs(frame_end - frame_start),
+                    ticksToMs(swap_start - frame_start),
+                    ticksToMs(frame_end - swap_start)
+                );
+            }
+            frame_start = frame_end;
+            frame_arena.endFrame();
+            gpu_tracer.resolve(false);
+            if (gl_profiler.endFrame()) {
+                gl_state.logFrame();
+            }
+
+            frame_count++;
+            if (frame_limit && frame_count >= frame_limit) {
+                running = false;
+            }
+        }
+
+        const f64 seconds = ticksToMs(SDL_GetPerformanceCounter() - start) /
+                            1000.0;
+
+        if (headless || software) {
+            if (!software) {
+                glFinish();
+            }
+            SDL_Log("Rendered %llu frames in %.3f s (%.1f frames/s)",
+                    (unsigned long long)frame_count, seconds,
+                    frame_count / seconds);
+        }
+        if (!software) {
+            gl_state.logTotals();
+        }
+        if (lazy_gl) {
+            gl_lazy_loader.logTotals();
+        }
+        frame_arena.logTotals();
+
+        if (benchmark &&
+            frame_profiler.writeReport(
+                benchmark_path,
+                (const char*)glGetString(GL_RENDERER)
+            )) {
+            SDL_Log("Benchmark results written to %s", benchmark_path);
+        }
+
+        if (capture_path) {
+            captureFrame(capture_path);
         }
     }
 
+    bool captureFrame(const char* path) {
+        if (!headless && !software) {
+            SDL_Log("Frame capture is only available with --headless or "
+                    "--software");
+            return false;
+        }
+
+        const auto pixels =
+            (u8*)SDL_malloc((usize)window_width * window_height * 4);
+        if (software) {
+            software_rasterizer.readPixels(pixels);
+        } else {
+            headless_context.readPixels(pixels);
+        }
+        const bool written =
+            writePPM(path, window_width, window_height, pixels, true);
+        SDL_free(pixels);
+
+        if (written) {
+            SDL_Log("Captured frame to %s", path);
+        }
+        return written;
+    }
+
     void shutdown() {
-        glDeleteVertexArrays(1, &vao);
-        glDeleteProgram(program);
+        simulation.stop();
+        software_rasterizer.shutdown();
+        jobs.shutdown();
+        frame_arena.shutdown();
+
+        // Every other thread has stopped, and the context is still there for
+        // the last GPU zones.
+        if (trace_path) {
+            if (gl_loaded) {
+                gpu_tracer.resolve(true);
+                gpu_tracer.shutdown();
+            }
+            tracer.write(trace_path);
+            tracer.shutdown();
+            trace_path = nullptr;
+        }
+
+        if (gl_loaded) {
+            destroyInstances();
+            compute_expansion.shutdown();
+            command_queue.shutdown();
+            multi_draw.shutdown();
+            gpu_culling.shutdown();
+            glDeleteVertexArrays(1, &vao);
+            shader_variants.shutdown();
+            shader_reloader.shutdown();
+            shader_compiler.shutdown();
+            program_cache.shutdown();
+            frame_profiler.shutdown();
+            frame_capture.shutdown();
+            gl_profiler.disable();
+            headless_context.shutdown();
+            gl_loaded = false;
+        }
 
         if (window) {
             SDL_DestroyWindow(window);
@@ -289,18 +1902,218 @@ struct Application {
     ~Application() { shutdown(); }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     Application app;
 
+    // The Linux build makes two more executables from this file (see
+    // CMakeLists.txt), which only start from other defaults.
+#if defined(MAIN_BENCH)
+    app.headless = true;
+    app.benchmark = true;
+    app.frame_limit = 600;
+    app.instance_count = 100000;
+    app.animate_instances = true;
+#elif defined(MAIN_GOLDEN)
+    app.golden_directory = "golden";
+    app.headless = true;
+    app.use_simulation_thread = false;
+#endif
+
+    for (i32 i = 1; i < argc; i++) {
+        if (SDL_strcmp(argv[i], "--no-program-cache") == 0) {
+            app.use_program_cache = false;
+        } else if (SDL_strcmp(argv[i], "--clear-program-cache") == 0) {
+            app.clear_program_cache = true;
+        } else if (SDL_strcmp(argv[i], "--bench-startup") == 0) {
+            app.bench_startup = true;
+        } else if (SDL_strcmp(argv[i], "--headless") == 0) {
+            app.headless = true;
+        } else if (SDL_strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            app.frame_limit = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            app.capture_path = argv[++i];
+        } else if (SDL_strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            app.record_path = argv[++i];
+        } else if (SDL_strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            app.golden_directory = argv[++i];
+            app.headless = true;
+            app.use_simulation_thread = false;
+        } else if (SDL_strcmp(argv[i], "--update-golden") == 0) {
+            app.update_golden = true;
+        } else if (SDL_strcmp(argv[i], "--golden-tolerance") == 0 &&
+                   i + 1 < argc) {
+            const i32 tolerance = SDL_atoi(argv[++i]);
+            app.golden_tolerance = (u8)SDL_clamp(tolerance, 0, 255);
+        } else if (SDL_strcmp(argv[i], "--golden-max-slowdown") == 0 &&
+                   i + 1 < argc) {
+            app.golden_max_slowdown = SDL_atof(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+            app.benchmark = true;
+            app.frame_limit = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--benchmark-out") == 0 &&
+                   i + 1 < argc) {
+            app.benchmark_path = argv[++i];
+        } else if (SDL_strcmp(argv[i], "--gl-debug") == 0) {
+            app.gl_debug_output = true;
+        } else if (SDL_strcmp(argv[i], "--no-gl-debug") == 0) {
+            app.gl_debug_output = false;
+        } else if (SDL_strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            app.instance_count = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--animate-instances") == 0) {
+            app.animate_instances = true;
+        } else if (SDL_strcmp(argv[i], "--bench-instances") == 0) {
+            app.bench_instances = true;
+        } else if (SDL_strcmp(argv[i], "--no-sim-thread") == 0) {
+            app.use_simulation_thread = false;
+        } else if (SDL_strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc) {
+            app.simulation_rate = SDL_atof(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--tessellation") == 0) {
+            app.tessellation = true;
+        } else if (SDL_strcmp(argv[i], "--tess-level") == 0 && i + 1 < argc) {
+            app.tess_level = SDL_atof(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--tess-pixels") == 0 &&
+                   i + 1 < argc) {
+            const f64 pixels = SDL_atof(argv[++i]);
+            app.tess_pixels = SDL_max(pixels, 0.5);
+        } else if (SDL_strcmp(argv[i], "--bench-tessellation") == 0) {
+            app.tessellation = true;
+            app.bench_tessellation = true;
+        } else if (SDL_strcmp(argv[i], "--expand") == 0 && i + 1 < argc) {
+            i++;
+            if (SDL_strcmp(argv[i], "geometry") == 0) {
+                app.expansion = EXPANSION_GEOMETRY;
+            } else if (SDL_strcmp(argv[i], "compute") == 0) {
+                app.expansion = EXPANSION_COMPUTE;
+            } else {
+                SDL_Log("--expand takes geometry or compute");
+                return -1;
+            }
+        } else if (SDL_strcmp(argv[i], "--bench-expansion") == 0) {
+            app.bench_expansion = true;
+        } else if (SDL_strcmp(argv[i], "--bench-queue") == 0) {
+            app.bench_queue = true;
+        } else if (SDL_strcmp(argv[i], "--multi-draw") == 0) {
+            app.use_multi_draw = true;
+        } else if (SDL_strcmp(argv[i], "--multi-draw-count") == 0) {
+            app.use_multi_draw = true;
+            app.multi_draw_count = true;
+        } else if (SDL_strcmp(argv[i], "--bench-multi-draw") == 0) {
+            app.bench_multi_draw = true;
+        } else if (SDL_strcmp(argv[i], "--cull") == 0) {
+            app.culling = true;
+        } else if (SDL_strcmp(argv[i], "--no-occlusion-cull") == 0) {
+            app.gpu_culling.occlusion = false;
+        } else if (SDL_strcmp(argv[i], "--bench-culling") == 0) {
+            app.bench_culling = true;
+        } else if (SDL_strcmp(argv[i], "--software") == 0) {
+            app.software = true;
+        } else if (SDL_strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            app.thread_count = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--job-threads") == 0 &&
+                   i + 1 < argc) {
+            app.job_threads = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--bench-jobs") == 0) {
+            app.bench_jobs = true;
+        } else if (SDL_strcmp(argv[i], "--bench-arena") == 0) {
+            app.bench_arena = true;
+        } else if (SDL_strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            app.trace_path = argv[++i];
+        } else if (SDL_strcmp(argv[i], "--trace-events") == 0 &&
+                   i + 1 < argc) {
+            const i32 events = SDL_atoi(argv[++i]);
+            if (events <= 0) {
+                SDL_Log("--trace-events needs at least 1 event per thread");
+                return -1;
+            }
+            app.trace_events = (u32)events;
+        } else if (SDL_strcmp(argv[i], "--gl-profile") == 0 &&
+                   i + 1 < argc) {
+            const i32 interval = SDL_atoi(argv[++i]);
+            if (interval <= 0) {
+                SDL_Log("--gl-profile needs an interval of at least 1 frame");
+                return -1;
+            }
+            app.gl_profile_interval = (u32)interval;
+        } else if (SDL_strcmp(argv[i], "--lazy-gl") == 0) {
+            app.lazy_gl = true;
+        } else if (SDL_strcmp(argv[i], "--bench-gl-loader") == 0) {
+            app.lazy_gl = true;
+            app.bench_gl_loader = true;
+        } else if (SDL_strcmp(argv[i], "--bench-software") == 0) {
+            app.software = true;
+            app.bench_software = true;
+        } else if (SDL_strcmp(argv[i], "--hot-reload") == 0) {
+            app.hot_reload = true;
+        } else if (SDL_strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc) {
+            app.shader_directory = argv[++i];
+        } else {
+            SDL_Log("Unknown argument: %s", argv[i]);
+            return -1;
+        }
+    }
+
+    if (!(app.simulation_rate >= SimulationThread::MIN_TICK_RATE)) {
+        SDL_Log("--sim-rate needs at least %.0f tick per second",
+                SimulationThread::MIN_TICK_RATE);
+        return -1;
+    }
+
+    if (app.benchmark && app.frame_limit == 0) {
+        SDL_Log("--benchmark needs a frame count greater than zero");
+        return -1;
+    }
+
+    if (app.software && (app.benchmark || app.bench_instances ||
+                         app.animate_instances || app.bench_startup ||
+                         app.hot_reload || app.record_path ||
+                         app.golden_directory || app.tessellation ||
+                         app.expansion || app.bench_expansion ||
+                         app.bench_queue || app.use_multi_draw ||
+                         app.bench_multi_draw || app.culling ||
+                         app.bench_culling || app.gl_profile_interval ||
+                         app.lazy_gl)) {
+        SDL_Log("--software has no GL context; drop the GL-only options");
+        return -1;
+    }
+
+    if (app.expansion == EXPANSION_COMPUTE && app.tessellation) {
+        SDL_Log("--expand compute replaces the vertex pipeline and cannot "
+                "be combined with --tessellation");
+        return -1;
+    }
+
+    if (app.expansion == EXPANSION_COMPUTE && app.use_multi_draw) {
+        SDL_Log("--expand compute draws its own indirect command and cannot "
+                "be combined with --multi-draw");
+        return -1;
+    }
+
+    if (app.culling && (app.expansion == EXPANSION_COMPUTE ||
+                        app.use_multi_draw)) {
+        SDL_Log("--cull draws through its own indirect command and cannot "
+                "be combined with --expand compute or --multi-draw");
+        return -1;
+    }
+
+    if (app.bench_expansion && app.tessellation) {
+        SDL_Log("--bench-expansion cannot be combined with --tessellation");
+        return -1;
+    }
+
+    const auto start = SDL_GetPerformanceCounter();
+
     if (!app.initialize()) {
         SDL_Log("Failed to initialize application");
         return -1;
     }
 
+    SDL_Log("Startup took %.3f ms",
+            (SDL_GetPerformanceCounter() - start) * 1000.0 /
+                SDL_GetPerformanceFrequency());
     SDL_Log("Application initialized successfully");
     SDL_Log("Press ESC to exit");
 
     app.run();
 
-    return 0;
+    return app.exit_code;
 }
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "frame_arena.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "types.h"
+
+// The record glDrawArraysIndirect and glMultiDrawArraysIndirect read.
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first;
+    GLuint base_instance;
+};
+
+// ARB_indirect_parameters is not in the generated loader.
+#define GL_PARAMETER_BUFFER_ARB 0x80EE
+typedef void (APIENTRYP PFNGLMULTIDRAWARRAYSINDIRECTCOUNTARBPROC)(
+    GLenum mode,
+    const void* indirect,
+    GLintptr drawcount,
+    GLsizei maxdrawcount,
+    GLsizei stride
+);
+
+// Issues a whole frame of draws with one glMultiDrawArraysIndirect. Each
+// draw is one DrawArraysIndirectCommand in `commands`, and the shader finds
+// its per-draw data by gl_DrawIDARB in a storage buffer bound at
+// PER_DRAW_BINDING (the MULTI_DRAW variant of vertex.glsl). With
+// ARB_indirect_parameters the draw count is read from `parameters` on the
+// GPU instead, so a compute pass can decide it without a readback.
+struct MultiDrawIndirect {
+    static constexpr GLuint PER_DRAW_BINDING = 0;
+
+    GLStateCache* state = nullptr;
+    PFNGLMULTIDRAWARRAYSINDIRECTCOUNTARBPROC multiDrawArraysIndirectCount =
+        nullptr;
+    GLuint commands = 0;
+    GLuint parameters = 0;
+    u32 capacity = 0;
+    u32 draw_count = 0;
+    u32 vertex_count = 0;
+
+    // Fails without ARB_shader_draw_parameters, which provides
+    // gl_DrawIDARB. The count variant is optional.
+    bool initialize(GLStateCache* gl_state, GLADloadproc loader) {
+        if (!hasGLExtension("GL_ARB_shader_draw_parameters")) {
+            SDL_Log("Multi-draw needs GL_ARB_shader_draw_parameters");
+            return false;
+        }
+
+        state = gl_state;
+        if (hasGLExtension("GL_ARB_indirect_parameters")) {
+            multiDrawArraysIndirectCount =
+                (PFNGLMULTIDRAWARRAYSINDIRECTCOUNTARBPROC)loader(
+                    "glMultiDrawArraysIndirectCountARB"
+                );
+        }
+
+        glCreateBuffers(1, &parameters);
+        glNamedBufferStorage(parameters, sizeof(GLuint), nullptr,
+                             GL_DYNAMIC_STORAGE_BIT);
+
+        SDL_Log("Multi-draw indirect ready (count variant %s)",
+                multiDrawArraysIndirectCount ? "available" : "unavailable");
+        return true;
+    }
+
+    // Writes `count` commands of `vertices` vertices each; draw i reads
+    // element i of the per-draw data. The records only change with the set
+    // of draws, so this runs when the scene changes, not every frame. They
+    // are staged in `arena`. Returns false, with no draws left to issue,
+    // when the arena is out of memory.
+    bool setDraws(u32 count, u32 vertices, FrameArena* arena) {
+        if (count == draw_count && vertices == vertex_count) {
+            return true;
+        }
+
+        const auto records =
+            arena->allocateArray<DrawArraysIndirectCommand>(count);
+        if (!records) {
+            draw_count = vertex_count = 0;
+            return false;
+        }
+        for (u32 i = 0; i < count; i++) {
+            records[i] = {vertices, 1, 0, 0};
+        }
+
+        if (count > capacity) {
+            capacity = SDL_max(count, capacity * 2);
+            state->deleteBuffer(&commands);
+            glCreateBuffers(1, &commands);
+            glNamedBufferStorage(commands,
+                                 sizeof(DrawArraysIndirectCommand) * capacity,
+                                 nullptr, GL_DYNAMIC_STORAGE_BIT);
+        }
+        glNamedBufferSubData(commands, 0,
+                             sizeof(DrawArraysIndirectCommand) * count,
+                             records);
+
+        const GLuint count_value = count;
+        glNamedBufferSubData(parameters, 0, sizeof(count_value), &count_value);
+
+        draw_count = count;
+        vertex_count = vertices;
+        return true;
+    }
+
+    // Draws every command with `size` bytes of per-draw data from `source`
+    // at `offset`, using the count variant when `use_count` and available.
+    void draw(
+        GLenum mode,
+        GLuint source,
+        GLintptr offset,
+        GLsizeiptr size,
+        bool use_count
+    ) {
+        if (draw_count == 0) {
+            return;
+        }
+
+        state->bindBufferRange(GL_SHADER_STORAGE_BUFFER, PER_DRAW_BINDING,
+                               source, offset, size);
+        state->bindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+
+        if (use_count && multiDrawArraysIndirectCount) {
+            state->bindBuffer(GL_PARAMETER_BUFFER_ARB, parameters);
+            multiDrawArraysIndirectCount(mode, nullptr, 0, draw_count, 0);
+        } else {
+            glMultiDrawArraysIndirect(mode, nullptr, draw_count, 0);
+        }
+    }
+
+    void shutdown() {
+        if (!state) {
+            return;
+        }
+
+        state->deleteBuffer(&commands);
+        state->deleteBuffer(&parameters);
+        capacity = draw_count = vertex_count = 0;
+        multiDrawArraysIndirectCount = nullptr;
+        state = nullptr;
+    }
+};
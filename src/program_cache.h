@@ -0,0 +1,210 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "types.h"
+
+struct ShaderStage {
+    GLenum type;
+    const char* file;
+    const u8* source;
+    usize source_len;
+    // Inserted after the #version line, e.g. variant #defines.
+    const char* preamble = nullptr;
+};
+
+// FNV-1a, 64 bit. Only used to name cache entries, not for security.
+inline u64 hashBytes(
+    const void* data,
+    usize len,
+    u64 hash = 0xcbf29ce484222325
+) {
+    const auto bytes = (const u8*)data;
+    for (usize i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+// On-disk cache of linked program binaries. Entries are keyed by the shader
+// sources, the stage set and the driver strings, so a shader edit or a driver
+// update simply produces a new key and the old entry is never looked at again.
+// A driver may still reject a binary it produced (GL_LINK_STATUS is false
+// after glProgramBinary); such entries are deleted and the caller recompiles.
+struct ProgramCache {
+    static constexpr u32 MAGIC = 0x50474c43; // "CLGP"
+    static constexpr u32 FILE_VERSION = 1;
+
+    struct FileHeader {
+        u32 magic;
+        u32 version;
+        u64 key;
+        u32 format;
+        u32 length;
+    };
+
+    char* directory = nullptr;
+    u64 driver_hash = 0;
+    bool enabled = false;
+
+    bool initialize() {
+        GLint format_count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        if (format_count <= 0) {
+            SDL_Log("Program cache disabled: driver exposes no binary formats");
+            return false;
+        }
+
+        char* pref_path = SDL_GetPrefPath("johnpgr", "opengl-learning");
+        if (!pref_path) {
+            SDL_Log("Program cache disabled: %s", SDL_GetError());
+            return false;
+        }
+
+        char path[1024];
+        SDL_snprintf(path, sizeof(path), "%sprogram_cache/", pref_path);
+        SDL_free(pref_path);
+
+        if (!SDL_CreateDirectory(path)) {
+            SDL_Log("Program cache disabled: %s", SDL_GetError());
+            return false;
+        }
+        directory = SDL_strdup(path);
+
+        const auto renderer = (const char*)glGetString(GL_RENDERER);
+        const auto version = (const char*)glGetString(GL_VERSION);
+        driver_hash = hashBytes(renderer, SDL_strlen(renderer));
+        driver_hash = hashBytes(version, SDL_strlen(version), driver_hash);
+
+        enabled = true;
+        return true;
+    }
+
+    u64 computeKey(const ShaderStage* stages, usize count) const {
+        u64 key = driver_hash;
+        for (usize i = 0; i < count; i++) {
+            key = hashBytes(&stages[i].type, sizeof(stages[i].type), key);
+            key = hashBytes(stages[i].source, stages[i].source_len, key);
+            if (stages[i].preamble) {
+                key = hashBytes(stages[i].preamble,
+                                SDL_strlen(stages[i].preamble), key);
+            }
+        }
+        return key;
+    }
+
+    void entryPath(u64 key, char* path, usize path_len) const {
+        SDL_snprintf(path, path_len, "%s%016llx.bin", directory,
+                     (unsigned long long)key);
+    }
+
+    // Returns true when `program` was linked from a cached binary.
+    bool load(u64 key, GLuint program) {
+        if (!enabled) {
+            return false;
+        }
+
+        char path[1024];
+        entryPath(key, path, sizeof(path));
+
+        usize size = 0;
+        const auto data = (u8*)SDL_LoadFile(path, &size);
+        if (!data) {
+            return false;
+        }
+
+        FileHeader header;
+        bool valid = size >= sizeof(header);
+        if (valid) {
+            SDL_memcpy(&header, data, sizeof(header));
+            valid = header.magic == MAGIC && header.version == FILE_VERSION &&
+                    header.key == key &&
+                    header.length == size - sizeof(header);
+        }
+
+        if (valid) {
+            glProgramBinary(program, header.format, data + sizeof(header),
+                            header.length);
+
+            GLint success;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            valid = success;
+        }
+
+        SDL_free(data);
+
+        if (!valid) {
+            SDL_Log("Discarding stale program cache entry %s", path);
+            SDL_RemovePath(path);
+        }
+
+        return valid;
+    }
+
+    // `program` must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+    void store(u64 key, GLuint program) {
+        if (!enabled) {
+            return;
+        }
+
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        const usize size = sizeof(FileHeader) + length;
+        const auto data = (u8*)SDL_malloc(size);
+
+        FileHeader header = {MAGIC, FILE_VERSION, key, 0, (u32)length};
+        glGetProgramBinary(program, length, nullptr, &header.format,
+                           data + sizeof(header));
+        SDL_memcpy(data, &header, sizeof(header));
+
+        char path[1024];
+        entryPath(key, path, sizeof(path));
+        if (!SDL_SaveFile(path, data, size)) {
+            SDL_Log("Failed to write program cache entry %s: %s", path,
+                    SDL_GetError());
+        }
+
+        SDL_free(data);
+    }
+
+    void remove(u64 key) {
+        if (!enabled) {
+            return;
+        }
+
+        char path[1024];
+        entryPath(key, path, sizeof(path));
+        SDL_RemovePath(path);
+    }
+
+    void clear() {
+        if (!directory) {
+            return;
+        }
+
+        i32 count = 0;
+        char** entries = SDL_GlobDirectory(directory, "*.bin", 0, &count);
+        if (!entries) {
+            return;
+        }
+
+        char path[1024];
+        for (i32 i = 0; i < count; i++) {
+            SDL_snprintf(path, sizeof(path), "%s%s", directory, entries[i]);
+            SDL_RemovePath(path);
+        }
+        SDL_free(entries);
+    }
+
+    void shutdown() {
+        SDL_free(directory);
+        directory = nullptr;
+        enabled = false;
+    }
+};
@@ -0,0 +1,346 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "gl_extensions.h"
+#include "program_cache.h"
+#include "trace.h"
+#include "types.h"
+
+// GL_KHR_parallel_shader_compile is not part of the generated glad loader.
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+inline const char* getShaderTypeName(GLenum type) {
+    switch(type) {
+        case GL_VERTEX_SHADER: return "VERTEX";
+        case GL_FRAGMENT_SHADER: return "FRAGMENT";
+        case GL_GEOMETRY_SHADER: return "GEOMETRY";
+        case GL_TESS_CONTROL_SHADER: return "TESSELLATION_CONTROL";
+        case GL_TESS_EVALUATION_SHADER: return "TESSELLATION_EVALUATION";
+        case GL_COMPUTE_SHADER: return "COMPUTE";
+        default: return nullptr;
+    }
+}
+
+// glShaderSource with `preamble` spliced in right after the #version line,
+// which has to stay first. Without a #version line it goes in front.
+inline void setShaderSource(
+    GLuint shader,
+    const GLchar* code,
+    GLint code_len,
+    const char* preamble
+) {
+    if (!preamble) {
+        glShaderSource(shader, 1, &code, &code_len);
+        return;
+    }
+
+    GLint version_len = 0;
+    if (code_len >= 8 && SDL_strncmp(code, "#version", 8) == 0) {
+        while (version_len < code_len && code[version_len] != '\n') {
+            version_len++;
+        }
+        version_len = SDL_min(version_len + 1, code_len);
+    }
+
+    const GLchar* parts[] = {code, preamble, code + version_len};
+    const GLint lengths[] = {
+        version_len,
+        (GLint)SDL_strlen(preamble),
+        code_len - version_len,
+    };
+    glShaderSource(shader, 3, parts, lengths);
+}
+
+typedef i32 CompileHandle;
+
+enum CompileState {
+    COMPILE_FREE,
+    COMPILE_COMPILING,
+    COMPILE_LINKING,
+    COMPILE_DONE,
+    COMPILE_FAILED,
+};
+
+// Schedules program builds so that every glCompileShader/glLinkProgram is
+// issued before anything asks for its result. With
+// GL_KHR_parallel_shader_compile the driver compiles on its own threads and
+// poll() only looks at GL_COMPLETION_STATUS_KHR, which never blocks; without
+// it poll() falls back to the blocking status queries, but still only after
+// all the work has been submitted.
+struct ShaderCompiler {
+    static constexpr usize MAX_JOBS = 64;
+    static constexpr usize MAX_STAGES = 5;
+
+    struct Job {
+        CompileState state;
+        u64 key;
+        GLuint program;
+        GLuint shaders[MAX_STAGES];
+        GLenum types[MAX_STAGES];
+        usize stage_count;
+        u32 borrowed;      // bits of the shaders the job does not own
+        bool keep_shaders; // take() hands them out instead of deleting
+    };
+
+    ProgramCache* cache = nullptr;
+    bool parallel = false;
+    Job jobs[MAX_JOBS] = {};
+
+    void initialize(ProgramCache* program_cache, GLADloadproc loader) {
+        cache = program_cache;
+
+        auto maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)
+            loader("glMaxShaderCompilerThreadsKHR");
+        if (!maxShaderCompilerThreads) {
+            maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)
+                loader("glMaxShaderCompilerThreadsARB");
+        }
+
+        parallel = (hasGLExtension("GL_KHR_parallel_shader_compile") ||
+                    hasGLExtension("GL_ARB_parallel_shader_compile")) &&
+                   maxShaderCompilerThreads;
+
+        if (parallel) {
+            // 0xFFFFFFFF lets the driver pick the thread count.
+            maxShaderCompilerThreads(0xFFFFFFFF);
+        }
+
+        SDL_Log("Parallel shader compilation: %s",
+                parallel ? "enabled" : "unavailable");
+    }
+
+    // Issues the compiles for a program and returns immediately. A stage
+    // with a nonzero `compiled[i]` is linked from that shader object, which
+    // the job only borrows, instead of being compiled. With `keep_shaders`,
+    // take() hands the shader objects to the caller rather than deleting
+    // them. Returns -1 if every job slot is taken.
+    CompileHandle submit(
+        const ShaderStage* stages,
+        usize count,
+        const GLuint* compiled = nullptr,
+        bool keep_shaders = false
+    ) {
+        TRACE_ZONE("shader submit");
+        SDL_assert(count <= MAX_STAGES);
+
+        CompileHandle handle = -1;
+        for (usize i = 0; i < MAX_JOBS; i++) {
+            if (jobs[i].state == COMPILE_FREE) {
+                handle = (CompileHandle)i;
+                break;
+            }
+        }
+        if (handle < 0) {
+            SDL_Log("Shader compiler job queue is full");
+            return -1;
+        }
+
+        auto& job = jobs[handle];
+        job = {};
+        job.program = glCreateProgram();
+        job.keep_shaders = keep_shaders;
+
+        if (cache) {
+            job.key = cache->computeKey(stages, count);
+            if (cache->load(job.key, job.program)) {
+                job.state = COMPILE_DONE;
+                return handle;
+            }
+        }
+
+        job.stage_count = count;
+        for (usize i = 0; i < count; i++) {
+            const auto code = (const GLchar*)stages[i].source;
+            const auto code_len = (GLint)stages[i].source_len;
+
+            job.types[i] = stages[i].type;
+            if (compiled && compiled[i]) {
+                job.shaders[i] = compiled[i];
+                job.borrowed |= 1u << i;
+                continue;
+            }
+            job.shaders[i] = glCreateShader(stages[i].type);
+            setShaderSource(job.shaders[i], code, code_len,
+                            stages[i].preamble);
+            glCompileShader(job.shaders[i]);
+        }
+
+        job.state = COMPILE_COMPILING;
+        return handle;
+    }
+
+    bool isComplete(GLuint object, bool is_program) {
+        if (!parallel) {
+            return true;
+        }
+
+        GLint complete = GL_FALSE;
+        if (is_program) {
+            glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+        } else {
+            glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+        }
+        return complete;
+    }
+
+    void advance(Job& job) {
+        TRACE_ZONE("shader advance");
+        if (job.state == COMPILE_COMPILING) {
+            for (usize i = 0; i < job.stage_count; i++) {
+                if (!isComplete(job.shaders[i], false)) {
+                    return;
+                }
+            }
+
+            bool compiled = true;
+            for (usize i = 0; i < job.stage_count; i++) {
+                const auto type_name = getShaderTypeName(job.types[i]);
+                if (!type_name ||
+                    !checkShaderCompilation(job.shaders[i], type_name)) {
+                    compiled = false;
+                }
+                glAttachShader(job.program, job.shaders[i]);
+            }
+
+            if (compiled) {
+                glProgramParameteri(
+                    job.program,
+                    GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                    cache && cache->enabled
+                );
+                glLinkProgram(job.program);
+            }
+
+            if (!job.keep_shaders) {
+                releaseShaders(job);
+            }
+
+            job.state = compiled ? COMPILE_LINKING : COMPILE_FAILED;
+        }
+
+        if (job.state == COMPILE_LINKING) {
+            if (!isComplete(job.program, true)) {
+                return;
+            }
+
+            if (!checkProgramLinking(job.program)) {
+                job.state = COMPILE_FAILED;
+                return;
+            }
+
+            if (cache) {
+                cache->store(job.key, job.program);
+            }
+            job.state = COMPILE_DONE;
+        }
+    }
+
+    // Advances every pending job as far as it can go without blocking (when
+    // parallel compilation is available). Returns true once nothing is
+    // pending.
+    bool poll() {
+        bool idle = true;
+        for (auto& job : jobs) {
+            if (job.state == COMPILE_COMPILING ||
+                job.state == COMPILE_LINKING) {
+                advance(job);
+            }
+            if (job.state == COMPILE_COMPILING ||
+                job.state == COMPILE_LINKING) {
+                idle = false;
+            }
+        }
+        return idle;
+    }
+
+    void finish() {
+        TRACE_ZONE("shader finish");
+        while (!poll()) {
+            SDL_Delay(0);
+        }
+    }
+
+    CompileState state(CompileHandle handle) const {
+        return jobs[handle].state;
+    }
+
+    // Deletes the shaders the job owns; borrowed ones are left alone.
+    static void releaseShaders(Job& job) {
+        for (usize i = 0; i < job.stage_count; i++) {
+            if (!(job.borrowed & (1u << i))) {
+                glDeleteShader(job.shaders[i]);
+            }
+            job.shaders[i] = 0;
+        }
+    }
+
+    // Hands the linked program over to the caller and frees the slot. Returns
+    // 0 if the build failed. The job must no longer be pending. For a job
+    // submitted with `keep_shaders`, `shaders` receives its shader objects,
+    // borrowed or not, whether or not the build succeeded; they are 0 when
+    // the program came from the cache.
+    GLuint take(CompileHandle handle, GLuint* shaders = nullptr) {
+        auto& job = jobs[handle];
+        SDL_assert(job.state == COMPILE_DONE || job.state == COMPILE_FAILED);
+
+        if (shaders) {
+            SDL_memcpy(shaders, job.shaders, sizeof(job.shaders));
+        } else {
+            releaseShaders(job);
+        }
+
+        GLuint program = job.program;
+        if (job.state == COMPILE_FAILED) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+
+        job = {};
+        return program;
+    }
+
+    void shutdown() {
+        for (auto& job : jobs) {
+            releaseShaders(job);
+            if (job.state != COMPILE_FREE) {
+                glDeleteProgram(job.program);
+            }
+            job = {};
+        }
+    }
+
+    static bool checkShaderCompilation(GLuint shader, const char* type) {
+        GLint success;
+        GLchar log_msg[1024];
+
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+        if (!success) {
+            glGetShaderInfoLog(shader, sizeof(log_msg), nullptr, log_msg);
+            SDL_Log("ERROR::SHADER_COMPILATION_ERROR of type: %s\n%s", type,
+                    log_msg);
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool checkProgramLinking(GLuint program) {
+        GLint success;
+        GLchar log_msg[1024];
+
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+        if (!success) {
+            glGetProgramInfoLog(program, sizeof(log_msg), nullptr, log_msg);
+            SDL_Log("ERROR::PROGRAM_LINKING_ERROR\n%s", log_msg);
+            return false;
+        }
+
+        return true;
+    }
+};
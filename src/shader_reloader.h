@@ -0,0 +1,126 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "shader_variants.h"
+#include "types.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Development mode: watches the shader directory and hands a main-pipeline
+// stage file that changes to ShaderVariants, which rebuilds every variant
+// built from it. update() is called once per frame and never waits on the
+// driver when GL_KHR_parallel_shader_compile is available, so a slow
+// compile shows up as a late swap rather than a dropped frame. A variant's
+// program is replaced only after a successful link; on any error the old
+// one keeps running.
+struct ShaderReloader {
+    ShaderVariants* variants = nullptr;
+    char directory[512] = {};
+    i32 inotify_fd = -1;
+
+    // Build `shader_variants` with hot reload on, so that variants keep the
+    // shader objects their rebuilds reuse.
+    bool initialize(
+        const char* shader_directory,
+        ShaderVariants* shader_variants
+    ) {
+#ifdef __linux__
+        variants = shader_variants;
+        SDL_snprintf(directory, sizeof(directory), "%s", shader_directory);
+
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            SDL_Log("Hot reload disabled: inotify_init1 failed (%d)", errno);
+            return false;
+        }
+
+        // Editors often save through a temporary file and a rename, so
+        // renames into the directory count as writes too.
+        if (inotify_add_watch(inotify_fd, directory,
+                              IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            SDL_Log("Hot reload disabled: cannot watch %s (%d)", directory,
+                    errno);
+            close(inotify_fd);
+            inotify_fd = -1;
+            return false;
+        }
+
+        SDL_Log("Hot reload: watching %s", directory);
+        return true;
+#else
+        (void)shader_directory;
+        (void)shader_variants;
+        SDL_Log("Hot reload is only supported on Linux");
+        return false;
+#endif
+    }
+
+    void reloadSource(ShaderVariants::Source source) {
+        const char* file = variants->sources[source].file;
+        char path[1024];
+        SDL_snprintf(path, sizeof(path), "%s/%s", directory, file);
+
+        usize size = 0;
+        const auto code = (u8*)SDL_LoadFile(path, &size);
+        if (!code) {
+            SDL_Log("Hot reload: cannot read %s: %s", path, SDL_GetError());
+            return;
+        }
+
+        variants->setSource(source, code, size);
+        SDL_Log("Hot reload: recompiling %s", file);
+    }
+
+    void pollFiles() {
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+
+        for (;;) {
+            const auto len = read(inotify_fd, buffer, sizeof(buffer));
+            if (len <= 0) {
+                break;
+            }
+
+            for (char* ptr = buffer; ptr < buffer + len;) {
+                const auto event = (const inotify_event*)ptr;
+                ptr += sizeof(inotify_event) + event->len;
+
+                if (!event->len) {
+                    continue;
+                }
+                for (usize i = 0; i < ShaderVariants::SOURCE_COUNT; i++) {
+                    if (SDL_strcmp(event->name,
+                                   variants->sources[i].file) == 0) {
+                        reloadSource((ShaderVariants::Source)i);
+                    }
+                }
+            }
+        }
+#endif
+    }
+
+    void update() {
+        if (inotify_fd < 0) {
+            return;
+        }
+
+        pollFiles();
+        variants->updateReloads();
+    }
+
+    void shutdown() {
+#ifdef __linux__
+        if (inotify_fd >= 0) {
+            close(inotify_fd);
+            inotify_fd = -1;
+        }
+#endif
+        variants = nullptr;
+    }
+};
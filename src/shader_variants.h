@@ -0,0 +1,327 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "program_cache.h"
+#include "shader_compiler.h"
+#include "types.h"
+
+// Bits of a variant key. The low bits add optional stages to the
+// vertex + fragment pipeline; the feature bits become #defines in every
+// stage of the variant.
+enum VariantBits : u32 {
+    VARIANT_TESSELLATION = 1u << 0,
+    VARIANT_GEOMETRY = 1u << 1,
+
+    VARIANT_FIXED_TESS_LEVEL = 1u << 8,
+    VARIANT_MULTI_DRAW = 1u << 9,
+};
+
+struct VariantDefine {
+    u32 bit;
+    const char* name;
+};
+
+inline constexpr VariantDefine VARIANT_DEFINES[] = {
+    {VARIANT_FIXED_TESS_LEVEL, "FIXED_TESS_LEVEL"},
+    {VARIANT_MULTI_DRAW, "MULTI_DRAW"},
+};
+
+// Programs of the main pipeline, built from the embedded stage sources on
+// first use and kept in a small open-addressing table keyed by variant
+// bits. A variant nobody asks for is never compiled. request() only
+// submits the build, so callers that know what they will need can overlap
+// it with other work before get() waits for it.
+//
+// For hot reload, setSource() replaces a stage's source. Variants built
+// after that use the new one, and updateReloads() rebuilds each built
+// variant that has the stage without waiting on the driver. Only the
+// changed stages are compiled; the others are linked from the shader
+// objects the variant was built with, which it keeps when `keep_shaders` is
+// set. A variant swaps to its new program only once that has linked; until
+// then, and after any error, the old one keeps running.
+struct ShaderVariants {
+    static constexpr usize CAPACITY = 64; // power of two
+
+    enum Source {
+        SOURCE_VERTEX,
+        SOURCE_TESS_CONTROL,
+        SOURCE_TESS_EVALUATION,
+        SOURCE_GEOMETRY,
+        SOURCE_FRAGMENT,
+        SOURCE_COUNT,
+    };
+
+    struct Entry {
+        u32 bits;
+        bool used;
+        CompileHandle job; // -1 once the build has been collected
+        GLuint program;
+        char* preamble;
+        // Of the program, in stage order; 0 where there is none to reuse.
+        GLuint shaders[ShaderCompiler::MAX_STAGES];
+        CompileHandle reload_job; // -1 when no rebuild is running
+        u32 stale;      // bits of the Sources changed since `shaders`
+        u32 rebuilding; // `stale` as of the running rebuild
+        bool reload;    // rebuild once nothing else is running
+    };
+
+    ShaderCompiler* compiler = nullptr;
+    ShaderStage sources[SOURCE_COUNT] = {};
+    u8* loaded[SOURCE_COUNT] = {}; // sources owned after setSource()
+    bool keep_shaders = false;
+    Entry entries[CAPACITY] = {};
+    usize count = 0;
+
+    // `stage_sources` is indexed by Source; the code they point to must
+    // outlive this object, since variants are compiled lazily. With
+    // `hot_reload`, variants keep their shader objects for rebuilds.
+    void initialize(
+        ShaderCompiler* shader_compiler,
+        const ShaderStage* stage_sources,
+        bool hot_reload
+    ) {
+        compiler = shader_compiler;
+        keep_shaders = hot_reload;
+        for (usize i = 0; i < SOURCE_COUNT; i++) {
+            sources[i] = stage_sources[i];
+        }
+    }
+
+    // The entry for `bits`, or the empty slot where it belongs.
+    Entry* find(u32 bits) {
+        usize slot = (bits * 0x9E3779B9u) & (CAPACITY - 1);
+        while (entries[slot].used && entries[slot].bits != bits) {
+            slot = (slot + 1) & (CAPACITY - 1);
+        }
+        return &entries[slot];
+    }
+
+    // Fills `used` with the Sources of the stages of `bits`, in pipeline
+    // order, and returns how many there are.
+    static usize sourcesOf(u32 bits, Source* used) {
+        usize stage_count = 0;
+        used[stage_count++] = SOURCE_VERTEX;
+        if (bits & VARIANT_TESSELLATION) {
+            used[stage_count++] = SOURCE_TESS_CONTROL;
+            used[stage_count++] = SOURCE_TESS_EVALUATION;
+        }
+        if (bits & VARIANT_GEOMETRY) {
+            used[stage_count++] = SOURCE_GEOMETRY;
+        }
+        used[stage_count++] = SOURCE_FRAGMENT;
+        return stage_count;
+    }
+
+    // Fills `stages` with the stages of `bits`, in pipeline order, and
+    // returns how many there are.
+    usize stagesOf(
+        u32 bits,
+        const char* preamble,
+        ShaderStage* stages
+    ) const {
+        Source used[ShaderCompiler::MAX_STAGES];
+        const usize stage_count = sourcesOf(bits, used);
+        for (usize i = 0; i < stage_count; i++) {
+            stages[i] = sources[used[i]];
+            stages[i].preamble = preamble;
+        }
+        return stage_count;
+    }
+
+    static char* buildPreamble(u32 bits) {
+        char preamble[512] = {};
+        for (const auto& define : VARIANT_DEFINES) {
+            if (bits & define.bit) {
+                SDL_strlcat(preamble, "#define ", sizeof(preamble));
+                SDL_strlcat(preamble, define.name, sizeof(preamble));
+                SDL_strlcat(preamble, " 1\n", sizeof(preamble));
+            }
+        }
+        if (!preamble[0]) {
+            return nullptr;
+        }
+
+        // Keep compiler messages pointing at the right line of the file.
+        SDL_strlcat(preamble, "#line 2\n", sizeof(preamble));
+        return SDL_strdup(preamble);
+    }
+
+    // Starts building `bits` unless it is built or building already.
+    Entry* request(u32 bits) {
+        auto entry = find(bits);
+        if (entry->used) {
+            return entry;
+        }
+
+        if (count == CAPACITY - 1) {
+            SDL_Log("Shader variant table is full");
+            return nullptr;
+        }
+
+        *entry = {};
+        entry->bits = bits;
+        entry->used = true;
+        entry->preamble = buildPreamble(bits);
+        entry->reload_job = -1;
+        count++;
+
+        ShaderStage stages[ShaderCompiler::MAX_STAGES];
+        const usize stage_count = stagesOf(bits, entry->preamble, stages);
+        entry->job = compiler->submit(stages, stage_count, nullptr,
+                                      keep_shaders);
+        return entry;
+    }
+
+    // The stages of `bits` as its build sees them.
+    usize variantStages(u32 bits, ShaderStage* stages) {
+        const auto entry = request(bits);
+        return stagesOf(bits, entry ? entry->preamble : nullptr, stages);
+    }
+
+    // The program for `bits`, building it first if needed. Returns 0 if
+    // the variant fails to build.
+    GLuint get(u32 bits) {
+        const auto entry = request(bits);
+        if (!entry) {
+            return 0;
+        }
+
+        if (entry->job >= 0) {
+            while (compiler->state(entry->job) == COMPILE_COMPILING ||
+                   compiler->state(entry->job) == COMPILE_LINKING) {
+                compiler->poll();
+                SDL_Delay(0);
+            }
+            entry->program = compiler->take(
+                entry->job, keep_shaders ? entry->shaders : nullptr
+            );
+            entry->job = -1;
+
+            SDL_Log("Built shader variant 0x%x", bits);
+        }
+
+        return entry->program;
+    }
+
+    // Replaces the source of `source` with `code`, which was allocated
+    // with SDL_malloc and is now owned here, and marks every variant built
+    // from it for a rebuild.
+    void setSource(Source source, u8* code, usize code_len) {
+        SDL_free(loaded[source]);
+        loaded[source] = code;
+        sources[source].source = code;
+        sources[source].source_len = code_len;
+
+        for (auto& entry : entries) {
+            Source used[ShaderCompiler::MAX_STAGES];
+            const usize stage_count =
+                entry.used ? sourcesOf(entry.bits, used) : 0;
+            for (usize i = 0; i < stage_count; i++) {
+                if (used[i] == source) {
+                    entry.stale |= 1u << source;
+                    entry.reload = true;
+                }
+            }
+        }
+    }
+
+    // Collects finished rebuilds and starts the ones setSource() asked for.
+    // Never waits on the driver when parallel compilation is available.
+    void updateReloads() {
+        compiler->poll();
+
+        for (auto& entry : entries) {
+            if (!entry.used || entry.job >= 0) {
+                continue;
+            }
+
+            if (entry.reload_job >= 0) {
+                const CompileState state = compiler->state(entry.reload_job);
+                if (state != COMPILE_DONE && state != COMPILE_FAILED) {
+                    continue;
+                }
+                finishRebuild(entry);
+            }
+
+            if (entry.reload) {
+                startRebuild(entry);
+            }
+        }
+    }
+
+    void startRebuild(Entry& entry) {
+        Source used[ShaderCompiler::MAX_STAGES];
+        ShaderStage stages[ShaderCompiler::MAX_STAGES];
+        GLuint compiled[ShaderCompiler::MAX_STAGES] = {};
+        const usize stage_count = sourcesOf(entry.bits, used);
+        stagesOf(entry.bits, entry.preamble, stages);
+        for (usize i = 0; i < stage_count; i++) {
+            if (!(entry.stale & (1u << used[i]))) {
+                compiled[i] = entry.shaders[i];
+            }
+        }
+
+        // With every job slot taken, `reload` stays set for the next frame.
+        entry.reload_job =
+            compiler->submit(stages, stage_count, compiled, true);
+        if (entry.reload_job >= 0) {
+            entry.rebuilding = entry.stale;
+            entry.reload = false;
+        }
+    }
+
+    void finishRebuild(Entry& entry) {
+        GLuint shaders[ShaderCompiler::MAX_STAGES] = {};
+        const GLuint program = compiler->take(entry.reload_job, shaders);
+        entry.reload_job = -1;
+
+        // The rebuild borrowed the variant's unchanged shaders; whichever
+        // set is dropped, those stay until neither uses them.
+        GLuint* kept = program ? shaders : entry.shaders;
+        GLuint* dropped = program ? entry.shaders : shaders;
+        for (usize i = 0; i < ShaderCompiler::MAX_STAGES; i++) {
+            if (dropped[i] && dropped[i] != kept[i]) {
+                glDeleteShader(dropped[i]);
+            }
+        }
+
+        if (!program) {
+            SDL_Log("Hot reload: keeping the previous program of variant "
+                    "0x%x", entry.bits);
+            return;
+        }
+
+        SDL_memcpy(entry.shaders, shaders, sizeof(shaders));
+        glDeleteProgram(entry.program);
+        entry.program = program;
+        entry.stale &= ~entry.rebuilding;
+        SDL_Log("Hot reload: variant 0x%x swapped", entry.bits);
+    }
+
+    void shutdown() {
+        for (auto& entry : entries) {
+            if (!entry.used) {
+                continue;
+            }
+            if (entry.reload_job >= 0) {
+                compiler->finish();
+                finishRebuild(entry);
+            }
+            for (const GLuint shader : entry.shaders) {
+                if (shader) {
+                    glDeleteShader(shader);
+                }
+            }
+            glDeleteProgram(entry.program);
+            SDL_free(entry.preamble);
+            entry = {};
+        }
+        for (auto& code : loaded) {
+            SDL_free(code);
+            code = nullptr;
+        }
+        count = 0;
+    }
+};
@@ -0,0 +1,188 @@
+#version 430 core
+
+// Visibility pass ahead of the instanced draw. One invocation per instance
+// tests its bounding sphere against the clip volume and against the
+// hierarchical-Z pyramid of the previous frame; survivors are compacted into
+// `visible` and counted into the indirect draw's instance count, so culled
+// instances never reach the vertex shader. Compaction keeps submission
+// order, which decides the result wherever triangles overlap at equal
+// depth, so it takes three dispatches of this shader:
+//
+//   PHASE_TEST     sets the flag of each instance and counts the survivors
+//                  of each workgroup
+//   PHASE_SCAN     one workgroup turns the counts into offsets and writes
+//                  the total
+//   PHASE_SCATTER  copies each survivor to its workgroup's offset plus its
+//                  rank among the workgroup's survivors
+const uint PHASE_TEST = 0u;
+const uint PHASE_SCAN = 1u;
+const uint PHASE_SCATTER = 2u;
+const uint GROUP_SIZE = 64u;
+
+layout (local_size_x = 64) in;
+
+struct Instance {
+    vec4 offset_scale;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout (std430, binding = 1) writeonly buffer Visible {
+    Instance visible[];
+};
+
+// DrawArraysIndirectCommand
+layout (std430, binding = 2) buffer Command {
+    uint count;
+    uint instance_count;
+    uint first;
+    uint base_instance;
+} command;
+
+layout (std430, binding = 3) buffer Flags {
+    uint flags[];
+};
+
+// Survivors per workgroup, then the offset of each workgroup's survivors.
+layout (std430, binding = 4) buffer Groups {
+    uint groups[];
+};
+
+// Farthest depth per texel, one mip level per halving; see hiz_compute.glsl.
+layout (binding = 0) uniform sampler2D hiz;
+
+uniform vec4 offset;
+uniform uint total_count;
+uniform bool occlusion; // false until there is a pyramid to test against
+uniform uint phase;
+
+shared uint shared_flags[GROUP_SIZE];
+shared uint shared_sums[GROUP_SIZE];
+
+// vertex.glsl's triangle fits in a circle of this radius around its offset,
+// per unit of scale.
+const float RADIUS = 0.35355339;
+
+bool occluded(vec4 center, float radius) {
+    vec2 lo = clamp((center.xy - radius) / center.w * 0.5 + 0.5, 0.0, 1.0);
+    vec2 hi = clamp((center.xy + radius) / center.w * 0.5 + 0.5, 0.0, 1.0);
+    float nearest = (center.z - radius) / center.w * 0.5 + 0.5;
+
+    // The level at which the bounds are at most one texel wide, so that
+    // they touch at most 2x2 texels. Level sizes are rounded down, so texels
+    // are found from level 0 pixels: texel i of level n covers pixels
+    // i << n up to (i + 1) << n, and the last one the remainder as well.
+    vec2 base_size = vec2(textureSize(hiz, 0));
+    vec2 extent = (hi - lo) * base_size;
+    int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+    level = min(level, textureQueryLevels(hiz) - 1);
+
+    ivec2 size = textureSize(hiz, level);
+    ivec2 a = min(ivec2(lo * base_size) >> level, size - 1);
+    ivec2 b = min(ivec2(hi * base_size) >> level, size - 1);
+
+    float farthest = max(max(texelFetch(hiz, a, level).r,
+                             texelFetch(hiz, ivec2(b.x, a.y), level).r),
+                         max(texelFetch(hiz, ivec2(a.x, b.y), level).r,
+                             texelFetch(hiz, b, level).r));
+    return nearest > farthest;
+}
+
+bool isVisible(Instance instance) {
+    // Where vertex.glsl puts the triangle, in clip space.
+    vec4 center = vec4(instance.offset_scale.xy,
+                       0.5 + instance.offset_scale.w, 1.0) + offset;
+    float radius = RADIUS * instance.offset_scale.z;
+
+    if (any(greaterThan(center.xyz - radius, vec3(center.w))) ||
+        any(lessThan(center.xyz + radius, vec3(-center.w)))) {
+        return false;
+    }
+
+    return !(occlusion && occluded(center, radius));
+}
+
+void test(uint index, uint local) {
+    uint flag = 0u;
+    if (index < total_count) {
+        flag = isVisible(instances[index]) ? 1u : 0u;
+        flags[index] = flag;
+    }
+
+    shared_flags[local] = flag;
+    barrier();
+
+    if (local == 0u) {
+        uint survivors = 0u;
+        for (uint i = 0u; i < GROUP_SIZE; i++) {
+            survivors += shared_flags[i];
+        }
+        groups[gl_WorkGroupID.x] = survivors;
+    }
+}
+
+void scan(uint local) {
+    // Each invocation sums a contiguous run of workgroups, the runs are
+    // scanned serially, then each invocation rewrites its run as offsets.
+    uint group_count = (total_count + GROUP_SIZE - 1u) / GROUP_SIZE;
+    uint run = (group_count + GROUP_SIZE - 1u) / GROUP_SIZE;
+    uint begin = min(local * run, group_count);
+    uint end = min(begin + run, group_count);
+
+    uint sum = 0u;
+    for (uint i = begin; i < end; i++) {
+        sum += groups[i];
+    }
+    shared_sums[local] = sum;
+    barrier();
+
+    if (local == 0u) {
+        uint total = 0u;
+        for (uint i = 0u; i < GROUP_SIZE; i++) {
+            uint run_sum = shared_sums[i];
+            shared_sums[i] = total;
+            total += run_sum;
+        }
+        command.instance_count = total;
+    }
+    barrier();
+
+    uint offset_of_group = shared_sums[local];
+    for (uint i = begin; i < end; i++) {
+        uint survivors = groups[i];
+        groups[i] = offset_of_group;
+        offset_of_group += survivors;
+    }
+}
+
+void scatter(uint index, uint local) {
+    uint flag = index < total_count ? flags[index] : 0u;
+    shared_flags[local] = flag;
+    barrier();
+
+    if (flag == 0u) {
+        return;
+    }
+
+    uint rank = 0u;
+    for (uint i = 0u; i < local; i++) {
+        rank += shared_flags[i];
+    }
+    visible[groups[gl_WorkGroupID.x] + rank] = instances[index];
+}
+
+void main(void) {
+    uint index = gl_GlobalInvocationID.x;
+    uint local = gl_LocalInvocationID.x;
+
+    if (phase == PHASE_TEST) {
+        test(index, local);
+    } else if (phase == PHASE_SCAN) {
+        scan(local);
+    } else {
+        scatter(index, local);
+    }
+}
@@ -0,0 +1,56 @@
+#version 430 core
+
+// Compute equivalent of vertex.glsl followed by geometry.glsl: one
+// invocation per triangle writes its three corners as points. Each triangle
+// has fixed output slots rather than ones claimed with an atomic, so the
+// points come out in the same order as the geometry shader's on every run.
+layout (local_size_x = 64) in;
+
+struct Instance {
+    vec4 offset_scale;
+    vec4 color;
+};
+
+struct Point {
+    vec4 position;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout (std430, binding = 1) writeonly buffer Points {
+    Point points[];
+};
+
+uniform vec4 offset;
+uniform uint triangle_count;
+
+void main(void) {
+    const vec4 vertices[3] = vec4[3](vec4(0.25, -0.25, 0.5, 1.0),
+                                      vec4(-0.25, -0.25, 0.5, 1.0),
+                                      vec4(0.25, 0.25, 0.5, 1.0));
+
+    const vec4 colors[3] = vec4[3](vec4(1.0, 0.0, 0.0, 1.0),
+                                   vec4(0.0, 1.0, 0.0, 1.0),
+                                   vec4(0.0, 0.0, 1.0, 1.0));
+
+    uint triangle = gl_GlobalInvocationID.x;
+    if (triangle >= triangle_count) {
+        return;
+    }
+
+    Instance instance = instances[triangle];
+    uint first = triangle * 3u;
+
+    for (int i = 0; i < 3; i++) {
+        vec4 vertex = vertices[i];
+        vertex.xy = vertex.xy * instance.offset_scale.z +
+                    instance.offset_scale.xy;
+        vertex.z += instance.offset_scale.w;
+
+        points[first + i].position = vertex + offset;
+        points[first + i].color = colors[i] * instance.color;
+    }
+}
@@ -1,6 +1,6 @@
 #version 410 core
 
-in vec4 vs_color;
+layout (location = 0) in vec4 vs_color;
 
 out vec4 color;
 
@@ -3,11 +3,16 @@
 layout (triangles) in;
 layout (points, max_vertices = 3) out;
 
+layout (location = 0) in vec4 vertex_color[];
+
+layout (location = 0) out vec4 vs_color;
+
 void main(void) {
     int i;
 
     for (i = 0; i < gl_in.length(); i++) {
         gl_Position = gl_in[i].gl_Position;
+        vs_color = vertex_color[i];
         EmitVertex();
     }
 }
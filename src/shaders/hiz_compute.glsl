@@ -0,0 +1,45 @@
+#version 430 core
+
+// Builds one level of the hierarchical-Z pyramid: level 0 is a copy of the
+// depth buffer, and every level above holds the farthest depth of the
+// texels it covers, so a test against any level stays conservative.
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D depth;
+layout (r32f, binding = 0) readonly uniform image2D source;
+layout (r32f, binding = 1) writeonly uniform image2D destination;
+
+uniform bool from_depth; // level 0: read `depth` instead of `source`
+
+void main(void) {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destination);
+    if (any(greaterThanEqual(texel, size))) {
+        return;
+    }
+
+    if (from_depth) {
+        imageStore(destination, texel, vec4(texelFetch(depth, texel, 0).r));
+        return;
+    }
+
+    // The last texel of a level halved from an odd size also covers the
+    // source's last row or column.
+    ivec2 source_size = imageSize(source);
+    ivec2 extent = ivec2(2);
+    if ((source_size.x & 1) != 0 && texel.x == size.x - 1) {
+        extent.x = 3;
+    }
+    if ((source_size.y & 1) != 0 && texel.y == size.y - 1) {
+        extent.y = 3;
+    }
+
+    float farthest = 0.0;
+    for (int y = 0; y < extent.y; y++) {
+        for (int x = 0; x < extent.x; x++) {
+            ivec2 at = min(texel * 2 + ivec2(x, y), source_size - 1);
+            farthest = max(farthest, imageLoad(source, at).r);
+        }
+    }
+    imageStore(destination, texel, vec4(farthest));
+}
@@ -0,0 +1,18 @@
+#version 430 core
+
+// Pulls the points written by expand_compute.glsl.
+struct Point {
+    vec4 position;
+    vec4 color;
+};
+
+layout (std430, binding = 1) readonly buffer Points {
+    Point points[];
+};
+
+layout (location = 0) out vec4 vs_color;
+
+void main(void) {
+    gl_Position = points[gl_VertexID].position;
+    vs_color = points[gl_VertexID].color;
+}
@@ -2,14 +2,47 @@
 
 layout (vertices = 3) out;
 
+#ifdef FIXED_TESS_LEVEL
+// The same level on every edge and inside.
+uniform float fixed_level;
+#else
+// Framebuffer size in pixels and the on-screen length each edge segment
+// should have.
+uniform vec2 viewport;
+uniform float pixels_per_segment;
+
+float edgeLevel(vec4 a, vec4 b) {
+    vec2 pixels = (a.xy / a.w - b.xy / b.w) * 0.5 * viewport;
+    return clamp(length(pixels) / pixels_per_segment, 1.0, 64.0);
+}
+#endif
+
+layout (location = 0) in vec4 vs_color[];
+layout (location = 0) out vec4 tcs_color[];
+
 void main(void) {
     if (gl_InvocationID == 0) {
-        gl_TessLevelInner[0] = 5.0;
-        gl_TessLevelOuter[0] = 5.0;
-        gl_TessLevelOuter[1] = 5.0;
-        gl_TessLevelOuter[2] = 5.0;
+#ifdef FIXED_TESS_LEVEL
+        gl_TessLevelInner[0] = fixed_level;
+        gl_TessLevelOuter[0] = fixed_level;
+        gl_TessLevelOuter[1] = fixed_level;
+        gl_TessLevelOuter[2] = fixed_level;
+#else
+        // Outer level i belongs to the edge opposite vertex i. It only
+        // depends on that edge's end points, so an edge shared with a
+        // neighbouring patch gets the same level and no cracks open.
+        float level0 = edgeLevel(gl_in[1].gl_Position, gl_in[2].gl_Position);
+        float level1 = edgeLevel(gl_in[2].gl_Position, gl_in[0].gl_Position);
+        float level2 = edgeLevel(gl_in[0].gl_Position, gl_in[1].gl_Position);
+
+        gl_TessLevelInner[0] = max(level0, max(level1, level2));
+        gl_TessLevelOuter[0] = level0;
+        gl_TessLevelOuter[1] = level1;
+        gl_TessLevelOuter[2] = level2;
+#endif
     }
 
     gl_out[gl_InvocationID].gl_Position =
         gl_in[gl_InvocationID].gl_Position;
+    tcs_color[gl_InvocationID] = vs_color[gl_InvocationID];
 }
@@ -2,8 +2,15 @@
 
 layout (triangles, equal_spacing, cw) in;
 
+layout (location = 0) in vec4 tcs_color[];
+
+layout (location = 0) out vec4 vs_color;
+
 void main(void) {
     gl_Position = (gl_TessCoord.x * gl_in[0].gl_Position +
                     gl_TessCoord.y * gl_in[1].gl_Position +
                     gl_TessCoord.z * gl_in[2].gl_Position);
+    vs_color = gl_TessCoord.x * tcs_color[0] +
+               gl_TessCoord.y * tcs_color[1] +
+               gl_TessCoord.z * tcs_color[2];
 }
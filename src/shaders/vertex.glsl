@@ -1,8 +1,31 @@
 #version 410 core
 
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+#endif
+
 layout (location = 0) in vec4 offset;
+// Per-instance when drawing instanced, constant (1, 1, 1, 1) and
+// (0, 0, 1, 0) otherwise.
+layout (location = 1) in vec4 instance_color;
+layout (location = 2) in vec4 instance_offset_scale;
+
+#ifdef MULTI_DRAW
+// One Instance per draw of a glMultiDrawArraysIndirect, replacing the
+// attributes above.
+struct Instance {
+    vec4 offset_scale;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+#endif
 
-out vec4 vs_color;
+layout (location = 0) out vec4 vs_color;
 
 void main(void) {
     const vec4 vertices[3] = vec4[3](vec4(0.25, -0.25, 0.5, 1.0),
@@ -13,6 +36,18 @@ void main(void) {
                                    vec4(0.0, 1.0, 0.0, 1.0),
                                    vec4(0.0, 0.0, 1.0, 1.0));
 
-    gl_Position = vertices[gl_VertexID] + offset;
-    vs_color = colors[gl_VertexID];
+#ifdef MULTI_DRAW
+    vec4 offset_scale = instances[gl_DrawIDARB].offset_scale;
+    vec4 color = instances[gl_DrawIDARB].color;
+#else
+    vec4 offset_scale = instance_offset_scale;
+    vec4 color = instance_color;
+#endif
+
+    vec4 vertex = vertices[gl_VertexID];
+    vertex.xy = vertex.xy * offset_scale.z + offset_scale.xy;
+    vertex.z += offset_scale.w;
+
+    gl_Position = vertex + offset;
+    vs_color = colors[gl_VertexID] * color;
 }
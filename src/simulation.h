@@ -0,0 +1,128 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+#include <math.h>
+
+#include "trace.h"
+#include "triple_buffer.h"
+#include "types.h"
+
+// Everything that moves in the scene, as of one simulation tick.
+struct SimulationState {
+    f64 time;
+    f32 offset[4];
+};
+
+inline SimulationState evaluateSimulation(f64 time) {
+    return {
+        time,
+        {(f32)sin(time) * 0.5f, (f32)cos(time) * 0.6f, 0.0f, 0.0f},
+    };
+}
+
+inline SimulationState lerpSimulation(
+    const SimulationState& a,
+    const SimulationState& b,
+    f64 alpha
+) {
+    SimulationState state;
+    state.time = a.time + (b.time - a.time) * alpha;
+    for (usize i = 0; i < 4; i++) {
+        state.offset[i] = a.offset[i] + (b.offset[i] - a.offset[i]) * alpha;
+    }
+    return state;
+}
+
+// Runs the simulation on its own thread at a fixed tick rate and hands
+// snapshots to the render thread through a triple buffer. Each snapshot
+// carries the last two ticks, so the renderer can interpolate between them
+// no matter how many ticks it missed; drawing lags the simulation by up to
+// one tick in exchange for smooth motion at any frame rate. A tick that runs
+// long only delays the next ticks, never a frame.
+struct SimulationThread {
+    struct Snapshot {
+        SimulationState previous;
+        SimulationState current;
+        u64 published_ns;
+    };
+
+    TripleBuffer<Snapshot> snapshots;
+    SDL_Thread* thread = nullptr;
+    std::atomic<bool> running = false;
+    u64 tick_ns = 0;
+    u64 ticks = 0;
+
+    static constexpr f64 MIN_TICK_RATE = 1.0; // ticks per second
+
+    bool start(f64 tick_rate) {
+        SDL_assert(tick_rate >= MIN_TICK_RATE);
+        tick_ns = (u64)(1e9 / tick_rate);
+
+        // Seed every slot so the renderer has something before tick one.
+        const auto initial = evaluateSimulation(0.0);
+        for (auto& slot : snapshots.slots) {
+            slot = {initial, initial, SDL_GetTicksNS()};
+        }
+
+        running = true;
+        thread = SDL_CreateThread(threadMain, "simulation", this);
+        if (!thread) {
+            SDL_Log("Failed to start simulation thread: %s", SDL_GetError());
+            running = false;
+            return false;
+        }
+        return true;
+    }
+
+    static i32 threadMain(void* user_data) {
+        tracer.nameThread("simulation");
+        ((SimulationThread*)user_data)->loop();
+        return 0;
+    }
+
+    void loop() {
+        SimulationState current = evaluateSimulation(0.0);
+        u64 next_tick_ns = SDL_GetTicksNS() + tick_ns;
+
+        while (running.load(std::memory_order_relaxed)) {
+            const auto now = SDL_GetTicksNS();
+            if (now < next_tick_ns) {
+                SDL_DelayNS(next_tick_ns - now);
+                continue;
+            }
+
+            TRACE_ZONE("simulation tick");
+            const auto previous = current;
+            ticks++;
+            current = evaluateSimulation(ticks * tick_ns / 1e9);
+
+            auto& snapshot = snapshots.writeSlot();
+            snapshot = {previous, current, SDL_GetTicksNS()};
+            snapshots.publish();
+
+            next_tick_ns += tick_ns;
+        }
+    }
+
+    // State to draw at `now_ns`: the latest tick, blended in from the one
+    // before it over one tick period.
+    SimulationState sample(u64 now_ns) {
+        snapshots.acquire();
+        const auto& snapshot = snapshots.readSlot();
+
+        const f64 elapsed =
+            now_ns > snapshot.published_ns ? now_ns - snapshot.published_ns : 0;
+        const f64 alpha = SDL_min(elapsed / tick_ns, 1.0);
+        return lerpSimulation(snapshot.previous, snapshot.current, alpha);
+    }
+
+    void stop() {
+        if (thread) {
+            running = false;
+            SDL_WaitThread(thread, nullptr);
+            thread = nullptr;
+        }
+    }
+};
@@ -0,0 +1,655 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+#include "instances.h"
+#include "simulation.h"
+#include "types.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// CPU reference implementation of the GL pipeline in render(): the three
+// vertices from vertex.glsl moved by the offset (and by the instance
+// attributes when instancing), per-vertex colors interpolated across the
+// triangle, over the clear color. No depth test and no culling, like the GL
+// path. Output is RGBA8, bottom row first, the same layout glReadPixels
+// returns, so captures and comparisons treat both backends alike.
+//
+// Triangles are set up and binned into 64x64 tiles on the calling thread;
+// the tiles are then shaded in parallel by a pool of workers plus the caller.
+// Bins keep submission order, so overlapping triangles resolve exactly as
+// they do on the GPU. The inner loop shades 8 (AVX2) or 4 (SSE2) pixels at a
+// time, with a scalar fallback for other targets. SSE2 is the x86-64
+// baseline; the AVX2 loop is compiled for that target alone and picked at
+// startup when the CPU and OS support it, so the build needs no -mavx2.
+//
+// Vertices snap to SUBPIXEL_BITS of sub-pixel precision, as on the GPU, and
+// coverage comes from integer edge functions, so pixels on an edge shared by
+// two triangles go to exactly one of them.
+struct SoftwareRasterizer {
+    static constexpr i32 TILE_SIZE = 64;
+    static constexpr i32 MAX_THREADS = 64;
+    static constexpr i32 SUBPIXEL_BITS = 4; // the minimum GL allows
+    static constexpr i64 SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+    static constexpr i32 MAX_LANES = 8;
+
+    struct Triangle {
+        // E_i(x, y) = a[i] * x + b[i] * y + c[i] is the edge function of
+        // the edge opposite vertex i at the centre of pixel (x, y), in
+        // squared sub-pixel units. A pixel is covered when every
+        // E_i + bias[i] >= 0, where the bias is -1 for edges that are not
+        // top or left edges.
+        i64 a[3], b[3], c[3];
+        i32 bias[3];
+        // Vertex colors divided by the sum of the E_i (twice the area), so
+        // the interpolated color is sum E_i * color[i].
+        f32 color[3][4];
+        i32 min_x, min_y, max_x, max_y; // inclusive pixel bounds
+        // Whether E_i fits in 32 bits across the bounds, which the SIMD
+        // paths need; bigger triangles are shaded with the scalar path.
+        bool fits_i32;
+    };
+
+    using ShadeSpan = u64 (*)(
+        const Triangle& tri,
+        u32* row,
+        i32 x_begin,
+        i32 x_end,
+        i32 y
+    );
+
+    struct Worker {
+        SoftwareRasterizer* rasterizer;
+        SDL_Thread* thread;
+        u32 generation; // last frame this worker has seen
+    };
+
+    u32* pixels = nullptr;
+    i32 width = 0;
+    i32 height = 0;
+    i32 stride = 0; // in pixels, a multiple of MAX_LANES
+    i32 tiles_x = 0;
+    i32 tiles_y = 0;
+    f32 clear_color[4] = {0.0f, 0.2f, 0.0f, 1.0f};
+
+    ShadeSpan shade_span = shadeSpanScalar;
+    i32 lanes = 1;
+
+    Instance* instances = nullptr;
+    u32 instance_count = 0;
+
+    Triangle* triangles = nullptr;
+    u32 triangle_count = 0;
+    u32 triangle_capacity = 0;
+    u32* bin_offsets = nullptr; // tiles + 1 entries
+    u32* bin_entries = nullptr;
+    u32 bin_capacity = 0;
+
+    Worker workers[MAX_THREADS] = {};
+    i32 worker_count = 0;
+    std::atomic<u32> generation = 0;
+    std::atomic<i32> next_tile = 0;
+    std::atomic<i32> workers_done = 0;
+    std::atomic<bool> quit = false;
+    std::atomic<u64> fragments = 0;
+
+    bool initialize(i32 fb_width, i32 fb_height, i32 thread_count) {
+        width = fb_width;
+        height = fb_height;
+        stride = (width + MAX_LANES - 1) / MAX_LANES * MAX_LANES;
+        tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+        pixels = (u32*)SDL_aligned_alloc(
+            64, (usize)stride * height * sizeof(u32)
+        );
+        bin_offsets = (u32*)SDL_calloc(tiles_x * tiles_y + 1, sizeof(u32));
+        if (!pixels || !bin_offsets) {
+            SDL_Log("Failed to allocate software framebuffer");
+            return false;
+        }
+
+#if defined(__SSE2__) || defined(_M_X64)
+        if (hasAVX2()) {
+            shade_span = shadeSpanAVX2;
+            lanes = 8;
+        } else {
+            shade_span = shadeSpanSSE2;
+            lanes = 4;
+        }
+#endif
+
+        setInstances(nullptr, 0);
+        startWorkers(thread_count);
+
+        SDL_Log("Software rasterizer: %dx%d, %d threads, %d-wide SIMD",
+                width, height, worker_count + 1, lanes);
+        return true;
+    }
+
+    // Copies the instances to draw; with none, draws the single triangle.
+    void setInstances(const Instance* source, u32 count) {
+        SDL_free(instances);
+
+        if (count == 0) {
+            instance_count = 1;
+            instances = (Instance*)SDL_malloc(sizeof(Instance));
+            instances[0] = {
+                {0.0f, 0.0f, 1.0f, 0.0f},
+                {1.0f, 1.0f, 1.0f, 1.0f},
+            };
+            return;
+        }
+
+        instance_count = count;
+        instances = (Instance*)SDL_malloc(sizeof(Instance) * count);
+        SDL_memcpy(instances, source, sizeof(Instance) * count);
+    }
+
+    // `thread_count` includes the calling thread.
+    void startWorkers(i32 thread_count) {
+        stopWorkers();
+
+        worker_count = SDL_clamp(thread_count, 1, MAX_THREADS) - 1;
+        quit = false;
+        for (i32 i = 0; i < worker_count; i++) {
+            workers[i] = {this, nullptr, generation.load()};
+            workers[i].thread =
+                SDL_CreateThread(workerMain, "raster", &workers[i]);
+        }
+    }
+
+    void stopWorkers() {
+        if (worker_count == 0) {
+            return;
+        }
+
+        quit = true;
+        generation.fetch_add(1);
+        generation.notify_all();
+        for (i32 i = 0; i < worker_count; i++) {
+            SDL_WaitThread(workers[i].thread, nullptr);
+        }
+        worker_count = 0;
+    }
+
+    static i32 workerMain(void* user_data) {
+        const auto worker = (Worker*)user_data;
+        const auto rasterizer = worker->rasterizer;
+
+        for (;;) {
+            rasterizer->generation.wait(worker->generation);
+            worker->generation = rasterizer->generation.load();
+            if (rasterizer->quit) {
+                break;
+            }
+
+            rasterizer->shadeTiles();
+            rasterizer->workers_done.fetch_add(1);
+            rasterizer->workers_done.notify_one();
+        }
+
+        return 0;
+    }
+
+    void render(const SimulationState& state) {
+        setupTriangles(state);
+        binTriangles();
+
+        next_tile = 0;
+        workers_done = 0;
+        generation.fetch_add(1);
+        generation.notify_all();
+
+        shadeTiles();
+
+        for (i32 done = workers_done.load(); done < worker_count;
+             done = workers_done.load()) {
+            workers_done.wait(done);
+        }
+    }
+
+    // Viewport transform of vertex.glsl's output plus edge setup.
+    void setupTriangles(const SimulationState& state) {
+        static constexpr f32 VERTICES[3][2] = {
+            {0.25f, -0.25f}, {-0.25f, -0.25f}, {0.25f, 0.25f},
+        };
+        static constexpr f32 COLORS[3][4] = {
+            {1.0f, 0.0f, 0.0f, 1.0f},
+            {0.0f, 1.0f, 0.0f, 1.0f},
+            {0.0f, 0.0f, 1.0f, 1.0f},
+        };
+
+        if (triangle_capacity < instance_count) {
+            triangle_capacity = instance_count;
+            SDL_free(triangles);
+            triangles =
+                (Triangle*)SDL_malloc(sizeof(Triangle) * instance_count);
+        }
+        triangle_count = 0;
+
+        for (u32 i = 0; i < instance_count; i++) {
+            const auto& instance = instances[i];
+            const f32 scale = instance.offset_scale[2];
+
+            i64 x[3], y[3];
+            f32 color[3][4];
+            for (i32 v = 0; v < 3; v++) {
+                const f32 ndc_x = VERTICES[v][0] * scale +
+                                  instance.offset_scale[0] + state.offset[0];
+                const f32 ndc_y = VERTICES[v][1] * scale +
+                                  instance.offset_scale[1] + state.offset[1];
+                x[v] = (i64)SDL_roundf((ndc_x + 1.0f) * 0.5f * width *
+                                       SUBPIXEL_SCALE);
+                y[v] = (i64)SDL_roundf((ndc_y + 1.0f) * 0.5f * height *
+                                       SUBPIXEL_SCALE);
+                for (i32 c = 0; c < 4; c++) {
+                    color[v][c] = COLORS[v][c] * instance.color[c];
+                }
+            }
+
+            i64 area = (x[2] - x[1]) * (y[0] - y[1]) -
+                       (y[2] - y[1]) * (x[0] - x[1]);
+            if (area == 0) {
+                continue;
+            }
+
+            // Either winding is drawn (no culling); make it counter-clockwise.
+            i32 order[3] = {0, 1, 2};
+            if (area < 0) {
+                order[1] = 2;
+                order[2] = 1;
+                area = -area;
+            }
+
+            auto& tri = triangles[triangle_count];
+            const f32 inv_area = 1.0f / (f32)area;
+            i64 min_x = x[0], max_x = x[0], min_y = y[0], max_y = y[0];
+
+            for (i32 e = 0; e < 3; e++) {
+                // Weight of vertex e comes from the opposite edge p -> q.
+                const i32 v = order[e];
+                const i32 p = order[(e + 1) % 3];
+                const i32 q = order[(e + 2) % 3];
+                const i64 dx = x[q] - x[p];
+                const i64 dy = y[q] - y[p];
+
+                // E = dx * (py - y[p]) - dy * (px - x[p]) at the pixel
+                // centre (px, py) = ((x + 0.5), (y + 0.5)) * SUBPIXEL_SCALE.
+                const i64 half = SUBPIXEL_SCALE / 2;
+                tri.a[e] = -dy * SUBPIXEL_SCALE;
+                tri.b[e] = dx * SUBPIXEL_SCALE;
+                tri.c[e] = dx * (half - y[p]) - dy * (half - x[p]);
+
+                // Top-left rule (y up): pixels exactly on a top or left edge
+                // belong to this triangle, those on other edges do not.
+                const bool top_left = dy < 0 || (dy == 0 && dx < 0);
+                tri.bias[e] = top_left ? 0 : -1;
+
+                for (i32 c = 0; c < 4; c++) {
+                    tri.color[e][c] = color[v][c] * inv_area;
+                }
+
+                min_x = SDL_min(min_x, x[v]);
+                max_x = SDL_max(max_x, x[v]);
+                min_y = SDL_min(min_y, y[v]);
+                max_y = SDL_max(max_y, y[v]);
+            }
+
+            // Pixel centres are at +0.5, so pixel x is inside [min, max]
+            // when x >= ceil(min - 0.5) and x <= floor(max - 0.5). One pixel
+            // of slack either way keeps this simple and still exact, since
+            // the edge functions decide coverage.
+            tri.min_x = (i32)SDL_clamp(min_x / SUBPIXEL_SCALE - 1, 0,
+                                       (i64)width);
+            tri.min_y = (i32)SDL_clamp(min_y / SUBPIXEL_SCALE - 1, 0,
+                                       (i64)height);
+            tri.max_x = (i32)SDL_clamp(max_x / SUBPIXEL_SCALE + 1, -1,
+                                       (i64)width - 1);
+            tri.max_y = (i32)SDL_clamp(max_y / SUBPIXEL_SCALE + 1, -1,
+                                       (i64)height - 1);
+            if (tri.min_x > tri.max_x || tri.min_y > tri.max_y) {
+                continue;
+            }
+
+            // |E| is at most dx * |py - y[p]| + dy * |px - x[p]|, and spans
+            // reach up to 2 * MAX_LANES pixels past the bounds.
+            const i64 extent = SDL_max(max_x - min_x, max_y - min_y);
+            const i64 reach = extent + (2 * MAX_LANES + 2) * SUBPIXEL_SCALE;
+            tri.fits_i32 = 2 * extent * reach < ((i64)1 << 31);
+
+            triangle_count++;
+        }
+    }
+
+    // Counting sort of triangles into tiles, preserving submission order.
+    void binTriangles() {
+        const i32 tile_count = tiles_x * tiles_y;
+        SDL_memset(bin_offsets, 0, sizeof(u32) * (tile_count + 1));
+
+        for (u32 i = 0; i < triangle_count; i++) {
+            const auto& tri = triangles[i];
+            for (i32 ty = tri.min_y / TILE_SIZE; ty <= tri.max_y / TILE_SIZE;
+                 ty++) {
+                for (i32 tx = tri.min_x / TILE_SIZE;
+                     tx <= tri.max_x / TILE_SIZE; tx++) {
+                    bin_offsets[ty * tiles_x + tx + 1]++;
+                }
+            }
+        }
+
+        for (i32 t = 0; t < tile_count; t++) {
+            bin_offsets[t + 1] += bin_offsets[t];
+        }
+
+        const u32 total = bin_offsets[tile_count];
+        if (bin_capacity < total) {
+            bin_capacity = total;
+            SDL_free(bin_entries);
+            bin_entries = (u32*)SDL_malloc(sizeof(u32) * total);
+        }
+
+        // Fill using the end offsets as cursors, walking triangles backwards
+        // so each bin ends up in submission order.
+        for (u32 i = triangle_count; i-- > 0;) {
+            const auto& tri = triangles[i];
+            for (i32 ty = tri.min_y / TILE_SIZE; ty <= tri.max_y / TILE_SIZE;
+                 ty++) {
+                for (i32 tx = tri.min_x / TILE_SIZE;
+                     tx <= tri.max_x / TILE_SIZE; tx++) {
+                    const i32 t = ty * tiles_x + tx;
+                    bin_entries[--bin_offsets[t + 1]] = i;
+                }
+            }
+        }
+        // Each cursor has walked back to the start of its tile, so entry
+        // t + 1 now holds the start of tile t; shift them into place.
+        for (i32 t = 0; t < tile_count; t++) {
+            bin_offsets[t] = bin_offsets[t + 1];
+        }
+        bin_offsets[tile_count] = total;
+    }
+
+    void shadeTiles() {
+        const i32 tile_count = tiles_x * tiles_y;
+        u64 shaded = 0;
+
+        for (i32 t = next_tile.fetch_add(1); t < tile_count;
+             t = next_tile.fetch_add(1)) {
+            shaded += shadeTile(t);
+        }
+
+        fragments.fetch_add(shaded, std::memory_order_relaxed);
+    }
+
+    static u32 packColor(const f32* color) {
+        u32 packed = 0;
+        for (i32 c = 0; c < 4; c++) {
+            const f32 value = SDL_clamp(color[c], 0.0f, 1.0f);
+            packed |= (u32)(value * 255.0f + 0.5f) << (c * 8);
+        }
+        return packed;
+    }
+
+    u64 shadeTile(i32 tile) {
+        const i32 x0 = (tile % tiles_x) * TILE_SIZE;
+        const i32 y0 = (tile / tiles_x) * TILE_SIZE;
+        const i32 x1 = SDL_min(x0 + TILE_SIZE, width);
+        const i32 y1 = SDL_min(y0 + TILE_SIZE, height);
+
+        const u32 clear = packColor(clear_color);
+        for (i32 y = y0; y < y1; y++) {
+            u32* row = pixels + (usize)y * stride;
+            for (i32 x = x0; x < x1; x++) {
+                row[x] = clear;
+            }
+        }
+
+        u64 shaded = 0;
+        for (u32 e = bin_offsets[tile]; e < bin_offsets[tile + 1]; e++) {
+            const auto& tri = triangles[bin_entries[e]];
+
+            // Spans start on a MAX_LANES boundary so the vector paths only
+            // touch whole, aligned groups of pixels inside the stride.
+            const i32 span_x0 =
+                SDL_max(tri.min_x, x0) / MAX_LANES * MAX_LANES;
+            const i32 span_x1 = SDL_min(tri.max_x + 1, x1);
+            const i32 span_y0 = SDL_max(tri.min_y, y0);
+            const i32 span_y1 = SDL_min(tri.max_y + 1, y1);
+
+            for (i32 y = span_y0; y < span_y1; y++) {
+                u32* row = pixels + (usize)y * stride;
+                shaded += tri.fits_i32
+                              ? shade_span(tri, row, span_x0, span_x1, y)
+                              : shadeSpanScalar(tri, row, span_x0, span_x1, y);
+            }
+        }
+
+        return shaded;
+    }
+
+    // Scalar, with 64-bit edge functions, so it takes any triangle.
+    static u64 shadeSpanScalar(
+        const Triangle& tri,
+        u32* row,
+        i32 x_begin,
+        i32 x_end,
+        i32 y
+    ) {
+        u64 shaded = 0;
+        for (i32 x = x_begin; x < x_end; x++) {
+            i64 edge[3];
+            bool inside = true;
+            for (i32 e = 0; e < 3; e++) {
+                edge[e] = tri.a[e] * x + tri.b[e] * y + tri.c[e];
+                inside = inside && edge[e] + tri.bias[e] >= 0;
+            }
+            if (!inside) {
+                continue;
+            }
+
+            f32 color[4];
+            for (i32 c = 0; c < 4; c++) {
+                color[c] = (f32)edge[0] * tri.color[0][c] +
+                           (f32)edge[1] * tri.color[1][c] +
+                           (f32)edge[2] * tri.color[2][c];
+            }
+            row[x] = packColor(color);
+            shaded++;
+        }
+        return shaded;
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // AVX2 with OS support for the YMM registers.
+    static bool hasAVX2() {
+        u32 eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+            !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+            return false;
+        }
+
+        u32 xcr0, xcr0_high;
+        __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+        if ((xcr0 & 0x6) != 0x6) {
+            return false;
+        }
+
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+               (ebx & bit_AVX2);
+    }
+
+    __attribute__((target("avx2"))) static u64 shadeSpanAVX2(
+        const Triangle& tri,
+        u32* row,
+        i32 x_begin,
+        i32 x_end,
+        i32 y
+    ) {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i end = _mm256_set1_epi32(x_end);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 to_unorm = _mm256_set1_ps(255.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+
+        // Each lane steps its edge function on by 8 pixels per group.
+        __m256i edge[3], step[3], threshold[3];
+        for (i32 e = 0; e < 3; e++) {
+            const i32 a = (i32)tri.a[e];
+            const i32 start =
+                (i32)(tri.a[e] * x_begin + tri.b[e] * y + tri.c[e]);
+            edge[e] = _mm256_add_epi32(_mm256_set1_epi32(start),
+                                       _mm256_mullo_epi32(lanes,
+                                                          _mm256_set1_epi32(a)));
+            step[e] = _mm256_set1_epi32(8 * a);
+            threshold[e] = _mm256_set1_epi32(-1 - tri.bias[e]);
+        }
+
+        u64 shaded = 0;
+        for (i32 x = x_begin; x < x_end; x += 8) {
+            const __m256i px = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+
+            __m256 w[3];
+            __m256i mask = _mm256_cmpgt_epi32(end, px);
+            for (i32 e = 0; e < 3; e++) {
+                mask = _mm256_and_si256(
+                    mask, _mm256_cmpgt_epi32(edge[e], threshold[e])
+                );
+                w[e] = _mm256_cvtepi32_ps(edge[e]);
+                edge[e] = _mm256_add_epi32(edge[e], step[e]);
+            }
+
+            const i32 bits = _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+            if (!bits) {
+                continue;
+            }
+            shaded += __builtin_popcount(bits);
+
+            __m256i packed = _mm256_setzero_si256();
+            for (i32 c = 0; c < 4; c++) {
+                __m256 value = _mm256_setzero_ps();
+                for (i32 v = 0; v < 3; v++) {
+                    value = _mm256_add_ps(
+                        value,
+                        _mm256_mul_ps(w[v], _mm256_set1_ps(tri.color[v][c]))
+                    );
+                }
+                value = _mm256_min_ps(_mm256_max_ps(value, zero), one);
+                value = _mm256_add_ps(_mm256_mul_ps(value, to_unorm), half);
+                packed = _mm256_or_si256(
+                    packed,
+                    _mm256_slli_epi32(_mm256_cvttps_epi32(value), c * 8)
+                );
+            }
+
+            const auto dst = (__m256i*)(row + x);
+            const __m256i old = _mm256_load_si256(dst);
+            _mm256_store_si256(dst, _mm256_blendv_epi8(old, packed, mask));
+        }
+
+        return shaded;
+    }
+
+    static u64 shadeSpanSSE2(
+        const Triangle& tri,
+        u32* row,
+        i32 x_begin,
+        i32 x_end,
+        i32 y
+    ) {
+        const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+        const __m128i end = _mm_set1_epi32(x_end);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 to_unorm = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        // Each lane steps its edge function on by 4 pixels per group. SSE2
+        // has no 32-bit multiply, so the lane offsets are set directly.
+        __m128i edge[3], step[3], threshold[3];
+        for (i32 e = 0; e < 3; e++) {
+            const i32 a = (i32)tri.a[e];
+            const i32 start =
+                (i32)(tri.a[e] * x_begin + tri.b[e] * y + tri.c[e]);
+            edge[e] = _mm_add_epi32(_mm_set1_epi32(start),
+                                    _mm_setr_epi32(0, a, 2 * a, 3 * a));
+            step[e] = _mm_set1_epi32(4 * a);
+            threshold[e] = _mm_set1_epi32(-1 - tri.bias[e]);
+        }
+
+        u64 shaded = 0;
+        for (i32 x = x_begin; x < x_end; x += 4) {
+            const __m128i px = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+
+            __m128 w[3];
+            __m128i mask = _mm_cmplt_epi32(px, end);
+            for (i32 e = 0; e < 3; e++) {
+                mask = _mm_and_si128(mask,
+                                     _mm_cmpgt_epi32(edge[e], threshold[e]));
+                w[e] = _mm_cvtepi32_ps(edge[e]);
+                edge[e] = _mm_add_epi32(edge[e], step[e]);
+            }
+
+            const i32 bits = _mm_movemask_ps(_mm_castsi128_ps(mask));
+            if (!bits) {
+                continue;
+            }
+            shaded += __builtin_popcount(bits);
+
+            __m128i packed = _mm_setzero_si128();
+            for (i32 c = 0; c < 4; c++) {
+                __m128 value = _mm_setzero_ps();
+                for (i32 v = 0; v < 3; v++) {
+                    value = _mm_add_ps(
+                        value, _mm_mul_ps(w[v], _mm_set1_ps(tri.color[v][c]))
+                    );
+                }
+                value = _mm_min_ps(_mm_max_ps(value, zero), one);
+                value = _mm_add_ps(_mm_mul_ps(value, to_unorm), half);
+                packed = _mm_or_si128(
+                    packed, _mm_slli_epi32(_mm_cvttps_epi32(value), c * 8)
+                );
+            }
+
+            const auto dst = (__m128i*)(row + x);
+            _mm_store_si128(
+                dst,
+                _mm_or_si128(_mm_and_si128(mask, packed),
+                             _mm_andnot_si128(mask, _mm_load_si128(dst)))
+            );
+        }
+
+        return shaded;
+    }
+#endif
+
+    // Tightly packed copy of the framebuffer, bottom row first.
+    void readPixels(u8* rgba) const {
+        for (i32 y = 0; y < height; y++) {
+            SDL_memcpy(rgba + (usize)y * width * 4,
+                       pixels + (usize)y * stride, (usize)width * 4);
+        }
+    }
+
+    void shutdown() {
+        stopWorkers();
+        SDL_aligned_free(pixels);
+        SDL_free(instances);
+        SDL_free(triangles);
+        SDL_free(bin_offsets);
+        SDL_free(bin_entries);
+        pixels = nullptr;
+        instances = nullptr;
+        triangles = nullptr;
+        bin_offsets = nullptr;
+        bin_entries = nullptr;
+        triangle_capacity = 0;
+        bin_capacity = 0;
+    }
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+#include "types.h"
+
+// Single-producer/single-consumer ring buffer. push() and pop() never lock
+// or allocate, so the producer (the frame loop) is not disturbed by whoever
+// drains it. Capacity is rounded up to a power of two.
+template <typename T>
+struct SpscRing {
+    T* items = nullptr;
+    usize mask = 0;
+    alignas(64) std::atomic<usize> head = 0; // next slot to write
+    alignas(64) std::atomic<usize> tail = 0; // next slot to read
+
+    void initialize(usize min_capacity) {
+        usize capacity = 1;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+
+        items = (T*)SDL_calloc(capacity, sizeof(T));
+        mask = capacity - 1;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    // Returns false, dropping the item, when the ring is full.
+    bool push(const T& item) {
+        const auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+
+        items[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T* item) {
+        const auto t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        *item = items[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void shutdown() {
+        SDL_free(items);
+        items = nullptr;
+        mask = 0;
+    }
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <SDL3/SDL.h>
+
+#include "types.h"
+
+// Persistently mapped, coherent buffer split into one region per frame in
+// flight. Each frame writes its data straight into the mapping (no
+// glBufferSubData copy, no map/unmap) and ends with a fence; a region is only
+// reused once the fence of the frame that last used it has signalled, so the
+// driver never has to synchronise implicitly or rename the buffer.
+struct StreamBuffer {
+    static constexpr u32 FRAMES = 3;
+
+    GLuint buffer = 0;
+    u8* mapped = nullptr;
+    usize region_size = 0;
+    usize used = 0;
+    u32 region = FRAMES - 1;
+    GLsync fences[FRAMES] = {};
+    u64 frames = 0;
+    u64 stalls = 0;
+
+    bool initialize(usize frame_size) {
+        // Keep regions aligned for any use, uniform blocks included.
+        GLint ubo_alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ubo_alignment);
+        region_size = align(frame_size, SDL_max((usize)ubo_alignment, 256));
+
+        const GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, region_size * FRAMES, nullptr, flags);
+        mapped = (u8*)glMapNamedBufferRange(buffer, 0, region_size * FRAMES,
+                                            flags);
+        if (!mapped) {
+            SDL_Log("Failed to map stream buffer");
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+            return false;
+        }
+
+        return true;
+    }
+
+    static usize align(usize value, usize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Moves to the next region, waiting for the GPU to finish with it.
+    void beginFrame() {
+        region = (region + 1) % FRAMES;
+        used = 0;
+        frames++;
+
+        GLsync& fence = fences[region];
+        if (!fence) {
+            return;
+        }
+
+        // A zero timeout first, so stalls can be told apart from free waits.
+        auto status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            stalls++;
+            while (status == GL_TIMEOUT_EXPIRED) {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                          1000000000);
+            }
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    // Returns where to write `size` bytes this frame, and their offset in
+    // `buffer` for binding. Returns nullptr if the region is full.
+    void* allocate(usize size, usize alignment, GLintptr* buffer_offset) {
+        const usize start = align(used, alignment);
+        if (start + size > region_size) {
+            SDL_Log("Stream buffer region overflow (%zu > %zu bytes)",
+                    start + size, region_size);
+            return nullptr;
+        }
+
+        used = start + size;
+        *buffer_offset = (GLintptr)(region * region_size + start);
+        return mapped + *buffer_offset;
+    }
+
+    // Call after the last command that reads this frame's region.
+    void endFrame() {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void shutdown() {
+        for (auto& fence : fences) {
+            if (fence) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+
+        if (buffer) {
+            SDL_Log("Stream buffer stalled on %llu of %llu frames",
+                    (unsigned long long)stalls, (unsigned long long)frames);
+            glUnmapNamedBuffer(buffer);
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+            mapped = nullptr;
+        }
+    }
+};
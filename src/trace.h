@@ -0,0 +1,261 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+#include "types.h"
+
+// One timed zone. `name` must outlive the trace: a string literal.
+struct TraceEvent {
+    const char* name;
+    u64 begin_ns; // SDL_GetTicksNS() time base
+    u64 end_ns;
+};
+
+// A fixed run of a TraceBuffer's events.
+struct TraceChunk {
+    static constexpr u32 EVENTS = 4096;
+
+    TraceChunk* next;
+    TraceEvent events[EVENTS];
+};
+
+// Events of one thread (or of the GPU), in chunks allocated as they fill, so
+// a thread that records little costs little. Only its thread writes it, and
+// it publishes each event, and the chunk it went into, with a release store
+// of `count`, so the writer can read a buffer while its thread is still
+// running. A buffer holding `capacity` events drops any more.
+struct TraceBuffer {
+    TraceBuffer* next; // in Tracer::buffers
+    const char* name;
+    u32 id;
+    u32 capacity;
+    u64 dropped;
+    TraceChunk* first;
+    TraceChunk* last; // only read by the recording thread
+    std::atomic<u32> count;
+
+    void push(const TraceEvent& event) {
+        const u32 index = count.load(std::memory_order_relaxed);
+        if (index == capacity) {
+            dropped++;
+            return;
+        }
+
+        if (index % TraceChunk::EVENTS == 0) {
+            const auto chunk = (TraceChunk*)SDL_malloc(sizeof(TraceChunk));
+            if (!chunk) {
+                dropped++;
+                return;
+            }
+            chunk->next = nullptr;
+            if (last) {
+                last->next = chunk;
+            } else {
+                first = chunk;
+            }
+            last = chunk;
+        }
+
+        last->events[index % TraceChunk::EVENTS] = event;
+        count.store(index + 1, std::memory_order_release);
+    }
+
+    void freeChunks() {
+        for (TraceChunk* chunk = first; chunk;) {
+            TraceChunk* following = chunk->next;
+            SDL_free(chunk);
+            chunk = following;
+        }
+        first = last = nullptr;
+    }
+};
+
+// Collects zones from every thread and writes them as Chrome trace JSON,
+// which chrome://tracing and Perfetto open as a timeline. Each thread gets
+// its own buffer on its first event; buffers are pushed onto a lock-free
+// list and nothing on the recording path locks, apart from the allocation
+// of a new chunk every TraceChunk::EVENTS events. Off until initialize(),
+// and then a zone costs two SDL_GetTicksNS() calls and a store.
+//
+// Each thread remembers its buffer together with the generation it was made
+// in. shutdown() frees every buffer and starts a new generation, so a thread
+// that outlives it never writes through the pointer it kept: it records
+// nothing while tracing is off and makes a new buffer if it comes back on.
+struct Tracer {
+    static constexpr u32 DEFAULT_EVENTS_PER_THREAD = 1 << 18;
+
+    struct ThreadBuffer {
+        TraceBuffer* buffer;
+        u32 generation;
+    };
+
+    std::atomic<bool> enabled = false;
+    std::atomic<TraceBuffer*> buffers = nullptr;
+    std::atomic<u32> next_id = 0;
+    std::atomic<u32> generation = 0;
+    u32 events_per_thread = DEFAULT_EVENTS_PER_THREAD;
+
+    static ThreadBuffer& threadBuffer() {
+        static thread_local ThreadBuffer buffer = {nullptr, 0};
+        return buffer;
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Call before starting the threads to trace. Each thread keeps at most
+    // `max_events` events.
+    void initialize(u32 max_events = DEFAULT_EVENTS_PER_THREAD) {
+        events_per_thread = max_events;
+        enabled.store(true, std::memory_order_relaxed);
+        nameThread("main");
+    }
+
+    TraceBuffer* createBuffer(const char* name) {
+        const auto buffer = (TraceBuffer*)SDL_malloc(sizeof(TraceBuffer));
+        if (!buffer) {
+            return nullptr;
+        }
+
+        buffer->name = name;
+        buffer->id = next_id.fetch_add(1, std::memory_order_relaxed);
+        buffer->capacity = events_per_thread;
+        buffer->dropped = 0;
+        buffer->first = buffer->last = nullptr;
+        buffer->count.store(0, std::memory_order_relaxed);
+
+        buffer->next = buffers.load(std::memory_order_relaxed);
+        while (!buffers.compare_exchange_weak(buffer->next, buffer,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        }
+        return buffer;
+    }
+
+    TraceBuffer* currentBuffer() {
+        ThreadBuffer& local = threadBuffer();
+        const u32 current = generation.load(std::memory_order_acquire);
+        if (!local.buffer || local.generation != current) {
+            local = {createBuffer("thread"), current};
+        }
+        return local.buffer;
+    }
+
+    // Names the calling thread's track in the trace.
+    void nameThread(const char* name) {
+        if (!isEnabled()) {
+            return;
+        }
+        if (TraceBuffer* buffer = currentBuffer()) {
+            buffer->name = name;
+        }
+    }
+
+    void record(const char* name, u64 begin_ns, u64 end_ns) {
+        if (!isEnabled()) {
+            return;
+        }
+        if (TraceBuffer* buffer = currentBuffer()) {
+            buffer->push({name, begin_ns, end_ns});
+        }
+    }
+
+    // Writes every buffer. Threads may still be recording; what they record
+    // from here on is left out.
+    bool write(const char* path) {
+        SDL_IOStream* out = SDL_IOFromFile(path, "w");
+        if (!out) {
+            SDL_Log("Failed to open %s: %s", path, SDL_GetError());
+            return false;
+        }
+
+        SDL_IOprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        u64 written = 0;
+        u64 dropped = 0;
+        bool first = true;
+        for (TraceBuffer* buffer = buffers.load(std::memory_order_acquire);
+             buffer; buffer = buffer->next) {
+            SDL_IOprintf(out,
+                         "%s{\"name\": \"thread_name\", \"ph\": \"M\", "
+                         "\"pid\": 1, \"tid\": %u, "
+                         "\"args\": {\"name\": \"%s\"}}",
+                         first ? "" : ",\n", buffer->id, buffer->name);
+            SDL_IOprintf(out,
+                         ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", "
+                         "\"pid\": 1, \"tid\": %u, "
+                         "\"args\": {\"sort_index\": %u}}",
+                         buffer->id, buffer->id);
+            first = false;
+
+            const u32 count = buffer->count.load(std::memory_order_acquire);
+            const TraceChunk* chunk = buffer->first;
+            for (u32 i = 0; i < count; i++) {
+                if (i > 0 && i % TraceChunk::EVENTS == 0) {
+                    chunk = chunk->next;
+                }
+                const TraceEvent& event =
+                    chunk->events[i % TraceChunk::EVENTS];
+                SDL_IOprintf(out,
+                             ",\n{\"name\": \"%s\", \"ph\": \"X\", "
+                             "\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, "
+                             "\"tid\": %u}",
+                             event.name, event.begin_ns / 1000.0,
+                             (event.end_ns - event.begin_ns) / 1000.0,
+                             buffer->id);
+            }
+            written += count;
+            dropped += buffer->dropped;
+        }
+        SDL_IOprintf(out, "\n]}\n");
+
+        if (!SDL_CloseIO(out)) {
+            SDL_Log("Failed to write %s: %s", path, SDL_GetError());
+            return false;
+        }
+        SDL_Log("Trace of %llu zones written to %s (%llu dropped)",
+                (unsigned long long)written, path,
+                (unsigned long long)dropped);
+        return true;
+    }
+
+    // Join the traced threads first: one still inside record() when its
+    // buffer is freed is not covered by the generation check.
+    void shutdown() {
+        enabled.store(false, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+
+        TraceBuffer* buffer = buffers.exchange(nullptr);
+        while (buffer) {
+            TraceBuffer* next = buffer->next;
+            buffer->freeChunks();
+            SDL_free(buffer);
+            buffer = next;
+        }
+        threadBuffer() = {nullptr, 0};
+    }
+};
+
+inline Tracer tracer;
+
+// Records the enclosing scope as a zone on the calling thread.
+struct TraceZone {
+    const char* name;
+    u64 begin_ns;
+
+    explicit TraceZone(const char* zone_name)
+        : name(zone_name),
+          begin_ns(tracer.isEnabled() ? SDL_GetTicksNS() : 0) {}
+
+    ~TraceZone() {
+        if (tracer.isEnabled()) {
+            tracer.record(name, begin_ns, SDL_GetTicksNS());
+        }
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+
+#include "types.h"
+
+// Lock-free triple buffer for handing the latest value from one producer
+// thread to one consumer thread. The producer always has a slot to write
+// into and the consumer always has a complete slot to read, so neither ever
+// waits; values the consumer did not get to in time are simply skipped.
+template <typename T>
+struct TripleBuffer {
+    static constexpr u32 INDEX_MASK = 3;
+    static constexpr u32 FRESH = 4;
+
+    T slots[3] = {};
+    u32 back = 0;  // producer's slot
+    u32 front = 1; // consumer's slot
+    std::atomic<u32> middle = 2;
+
+    T& writeSlot() { return slots[back]; }
+
+    // Makes the write slot visible to the consumer.
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) &
+               INDEX_MASK;
+    }
+
+    // Picks up the most recent published value, if there is one. Returns
+    // whether `readSlot()` changed.
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& readSlot() const { return slots[front]; }
+};
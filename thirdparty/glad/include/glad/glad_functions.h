@@ -0,0 +1,709 @@
+/*
+    Every OpenGL entry point declared in glad.h, as an X-macro list:
+
+        #define GLAD_FUNCTION(name) ...
+        #include <glad/glad_functions.h>
+        #undef GLAD_FUNCTION
+
+    `name` is the GL name (glClear); its loader pointer is glad_##name.
+    Regenerate after regenerating glad.h:
+
+        grep -o '^#define gl[A-Za-z0-9_]* glad_' glad.h |
+            sed 's/^#define \(gl[A-Za-z0-9_]*\) glad_$/GLAD_FUNCTION(\1)/'
+*/
+
+GLAD_FUNCTION(glCullFace)
+GLAD_FUNCTION(glFrontFace)
+GLAD_FUNCTION(glHint)
+GLAD_FUNCTION(glLineWidth)
+GLAD_FUNCTION(glPointSize)
+GLAD_FUNCTION(glPolygonMode)
+GLAD_FUNCTION(glScissor)
+GLAD_FUNCTION(glTexParameterf)
+GLAD_FUNCTION(glTexParameterfv)
+GLAD_FUNCTION(glTexParameteri)
+GLAD_FUNCTION(glTexParameteriv)
+GLAD_FUNCTION(glTexImage1D)
+GLAD_FUNCTION(glTexImage2D)
+GLAD_FUNCTION(glDrawBuffer)
+GLAD_FUNCTION(glClear)
+GLAD_FUNCTION(glClearColor)
+GLAD_FUNCTION(glClearStencil)
+GLAD_FUNCTION(glClearDepth)
+GLAD_FUNCTION(glStencilMask)
+GLAD_FUNCTION(glColorMask)
+GLAD_FUNCTION(glDepthMask)
+GLAD_FUNCTION(glDisable)
+GLAD_FUNCTION(glEnable)
+GLAD_FUNCTION(glFinish)
+GLAD_FUNCTION(glFlush)
+GLAD_FUNCTION(glBlendFunc)
+GLAD_FUNCTION(glLogicOp)
+GLAD_FUNCTION(glStencilFunc)
+GLAD_FUNCTION(glStencilOp)
+GLAD_FUNCTION(glDepthFunc)
+GLAD_FUNCTION(glPixelStoref)
+GLAD_FUNCTION(glPixelStorei)
+GLAD_FUNCTION(glReadBuffer)
+GLAD_FUNCTION(glReadPixels)
+GLAD_FUNCTION(glGetBooleanv)
+GLAD_FUNCTION(glGetDoublev)
+GLAD_FUNCTION(glGetError)
+GLAD_FUNCTION(glGetFloatv)
+GLAD_FUNCTION(glGetIntegerv)
+GLAD_FUNCTION(glGetString)
+GLAD_FUNCTION(glGetTexImage)
+GLAD_FUNCTION(glGetTexParameterfv)
+GLAD_FUNCTION(glGetTexParameteriv)
+GLAD_FUNCTION(glGetTexLevelParameterfv)
+GLAD_FUNCTION(glGetTexLevelParameteriv)
+GLAD_FUNCTION(glIsEnabled)
+GLAD_FUNCTION(glDepthRange)
+GLAD_FUNCTION(glViewport)
+GLAD_FUNCTION(glDrawArrays)
+GLAD_FUNCTION(glDrawElements)
+GLAD_FUNCTION(glPolygonOffset)
+GLAD_FUNCTION(glCopyTexImage1D)
+GLAD_FUNCTION(glCopyTexImage2D)
+GLAD_FUNCTION(glCopyTexSubImage1D)
+GLAD_FUNCTION(glCopyTexSubImage2D)
+GLAD_FUNCTION(glTexSubImage1D)
+GLAD_FUNCTION(glTexSubImage2D)
+GLAD_FUNCTION(glBindTexture)
+GLAD_FUNCTION(glDeleteTextures)
+GLAD_FUNCTION(glGenTextures)
+GLAD_FUNCTION(glIsTexture)
+GLAD_FUNCTION(glDrawRangeElements)
+GLAD_FUNCTION(glTexImage3D)
+GLAD_FUNCTION(glTexSubImage3D)
+GLAD_FUNCTION(glCopyTexSubImage3D)
+GLAD_FUNCTION(glActiveTexture)
+GLAD_FUNCTION(glSampleCoverage)
+GLAD_FUNCTION(glCompressedTexImage3D)
+GLAD_FUNCTION(glCompressedTexImage2D)
+GLAD_FUNCTION(glCompressedTexImage1D)
+GLAD_FUNCTION(glCompressedTexSubImage3D)
+GLAD_FUNCTION(glCompressedTexSubImage2D)
+GLAD_FUNCTION(glCompressedTexSubImage1D)
+GLAD_FUNCTION(glGetCompressedTexImage)
+GLAD_FUNCTION(glBlendFuncSeparate)
+GLAD_FUNCTION(glMultiDrawArrays)
+GLAD_FUNCTION(glMultiDrawElements)
+GLAD_FUNCTION(glPointParameterf)
+GLAD_FUNCTION(glPointParameterfv)
+GLAD_FUNCTION(glPointParameteri)
+GLAD_FUNCTION(glPointParameteriv)
+GLAD_FUNCTION(glBlendColor)
+GLAD_FUNCTION(glBlendEquation)
+GLAD_FUNCTION(glGenQueries)
+GLAD_FUNCTION(glDeleteQueries)
+GLAD_FUNCTION(glIsQuery)
+GLAD_FUNCTION(glBeginQuery)
+GLAD_FUNCTION(glEndQuery)
+GLAD_FUNCTION(glGetQueryiv)
+GLAD_FUNCTION(glGetQueryObjectiv)
+GLAD_FUNCTION(glGetQueryObjectuiv)
+GLAD_FUNCTION(glBindBuffer)
+GLAD_FUNCTION(glDeleteBuffers)
+GLAD_FUNCTION(glGenBuffers)
+GLAD_FUNCTION(glIsBuffer)
+GLAD_FUNCTION(glBufferData)
+GLAD_FUNCTION(glBufferSubData)
+GLAD_FUNCTION(glGetBufferSubData)
+GLAD_FUNCTION(glMapBuffer)
+GLAD_FUNCTION(glUnmapBuffer)
+GLAD_FUNCTION(glGetBufferParameteriv)
+GLAD_FUNCTION(glGetBufferPointerv)
+GLAD_FUNCTION(glBlendEquationSeparate)
+GLAD_FUNCTION(glDrawBuffers)
+GLAD_FUNCTION(glStencilOpSeparate)
+GLAD_FUNCTION(glStencilFuncSeparate)
+GLAD_FUNCTION(glStencilMaskSeparate)
+GLAD_FUNCTION(glAttachShader)
+GLAD_FUNCTION(glBindAttribLocation)
+GLAD_FUNCTION(glCompileShader)
+GLAD_FUNCTION(glCreateProgram)
+GLAD_FUNCTION(glCreateShader)
+GLAD_FUNCTION(glDeleteProgram)
+GLAD_FUNCTION(glDeleteShader)
+GLAD_FUNCTION(glDetachShader)
+GLAD_FUNCTION(glDisableVertexAttribArray)
+GLAD_FUNCTION(glEnableVertexAttribArray)
+GLAD_FUNCTION(glGetActiveAttrib)
+GLAD_FUNCTION(glGetActiveUniform)
+GLAD_FUNCTION(glGetAttachedShaders)
+GLAD_FUNCTION(glGetAttribLocation)
+GLAD_FUNCTION(glGetProgramiv)
+GLAD_FUNCTION(glGetProgramInfoLog)
+GLAD_FUNCTION(glGetShaderiv)
+GLAD_FUNCTION(glGetShaderInfoLog)
+GLAD_FUNCTION(glGetShaderSource)
+GLAD_FUNCTION(glGetUniformLocation)
+GLAD_FUNCTION(glGetUniformfv)
+GLAD_FUNCTION(glGetUniformiv)
+GLAD_FUNCTION(glGetVertexAttribdv)
+GLAD_FUNCTION(glGetVertexAttribfv)
+GLAD_FUNCTION(glGetVertexAttribiv)
+GLAD_FUNCTION(glGetVertexAttribPointerv)
+GLAD_FUNCTION(glIsProgram)
+GLAD_FUNCTION(glIsShader)
+GLAD_FUNCTION(glLinkProgram)
+GLAD_FUNCTION(glShaderSource)
+GLAD_FUNCTION(glUseProgram)
+GLAD_FUNCTION(glUniform1f)
+GLAD_FUNCTION(glUniform2f)
+GLAD_FUNCTION(glUniform3f)
+GLAD_FUNCTION(glUniform4f)
+GLAD_FUNCTION(glUniform1i)
+GLAD_FUNCTION(glUniform2i)
+GLAD_FUNCTION(glUniform3i)
+GLAD_FUNCTION(glUniform4i)
+GLAD_FUNCTION(glUniform1fv)
+GLAD_FUNCTION(glUniform2fv)
+GLAD_FUNCTION(glUniform3fv)
+GLAD_FUNCTION(glUniform4fv)
+GLAD_FUNCTION(glUniform1iv)
+GLAD_FUNCTION(glUniform2iv)
+GLAD_FUNCTION(glUniform3iv)
+GLAD_FUNCTION(glUniform4iv)
+GLAD_FUNCTION(glUniformMatrix2fv)
+GLAD_FUNCTION(glUniformMatrix3fv)
+GLAD_FUNCTION(glUniformMatrix4fv)
+GLAD_FUNCTION(glValidateProgram)
+GLAD_FUNCTION(glVertexAttrib1d)
+GLAD_FUNCTION(glVertexAttrib1dv)
+GLAD_FUNCTION(glVertexAttrib1f)
+GLAD_FUNCTION(glVertexAttrib1fv)
+GLAD_FUNCTION(glVertexAttrib1s)
+GLAD_FUNCTION(glVertexAttrib1sv)
+GLAD_FUNCTION(glVertexAttrib2d)
+GLAD_FUNCTION(glVertexAttrib2dv)
+GLAD_FUNCTION(glVertexAttrib2f)
+GLAD_FUNCTION(glVertexAttrib2fv)
+GLAD_FUNCTION(glVertexAttrib2s)
+GLAD_FUNCTION(glVertexAttrib2sv)
+GLAD_FUNCTION(glVertexAttrib3d)
+GLAD_FUNCTION(glVertexAttrib3dv)
+GLAD_FUNCTION(glVertexAttrib3f)
+GLAD_FUNCTION(glVertexAttrib3fv)
+GLAD_FUNCTION(glVertexAttrib3s)
+GLAD_FUNCTION(glVertexAttrib3sv)
+GLAD_FUNCTION(glVertexAttrib4Nbv)
+GLAD_FUNCTION(glVertexAttrib4Niv)
+GLAD_FUNCTION(glVertexAttrib4Nsv)
+GLAD_FUNCTION(glVertexAttrib4Nub)
+GLAD_FUNCTION(glVertexAttrib4Nubv)
+GLAD_FUNCTION(glVertexAttrib4Nuiv)
+GLAD_FUNCTION(glVertexAttrib4Nusv)
+GLAD_FUNCTION(glVertexAttrib4bv)
+GLAD_FUNCTION(glVertexAttrib4d)
+GLAD_FUNCTION(glVertexAttrib4dv)
+GLAD_FUNCTION(glVertexAttrib4f)
+GLAD_FUNCTION(glVertexAttrib4fv)
+GLAD_FUNCTION(glVertexAttrib4iv)
+GLAD_FUNCTION(glVertexAttrib4s)
+GLAD_FUNCTION(glVertexAttrib4sv)
+GLAD_FUNCTION(glVertexAttrib4ubv)
+GLAD_FUNCTION(glVertexAttrib4uiv)
+GLAD_FUNCTION(glVertexAttrib4usv)
+GLAD_FUNCTION(glVertexAttribPointer)
+GLAD_FUNCTION(glUniformMatrix2x3fv)
+GLAD_FUNCTION(glUniformMatrix3x2fv)
+GLAD_FUNCTION(glUniformMatrix2x4fv)
+GLAD_FUNCTION(glUniformMatrix4x2fv)
+GLAD_FUNCTION(glUniformMatrix3x4fv)
+GLAD_FUNCTION(glUniformMatrix4x3fv)
+GLAD_FUNCTION(glColorMaski)
+GLAD_FUNCTION(glGetBooleani_v)
+GLAD_FUNCTION(glGetIntegeri_v)
+GLAD_FUNCTION(glEnablei)
+GLAD_FUNCTION(glDisablei)
+GLAD_FUNCTION(glIsEnabledi)
+GLAD_FUNCTION(glBeginTransformFeedback)
+GLAD_FUNCTION(glEndTransformFeedback)
+GLAD_FUNCTION(glBindBufferRange)
+GLAD_FUNCTION(glBindBufferBase)
+GLAD_FUNCTION(glTransformFeedbackVaryings)
+GLAD_FUNCTION(glGetTransformFeedbackVarying)
+GLAD_FUNCTION(glClampColor)
+GLAD_FUNCTION(glBeginConditionalRender)
+GLAD_FUNCTION(glEndConditionalRender)
+GLAD_FUNCTION(glVertexAttribIPointer)
+GLAD_FUNCTION(glGetVertexAttribIiv)
+GLAD_FUNCTION(glGetVertexAttribIuiv)
+GLAD_FUNCTION(glVertexAttribI1i)
+GLAD_FUNCTION(glVertexAttribI2i)
+GLAD_FUNCTION(glVertexAttribI3i)
+GLAD_FUNCTION(glVertexAttribI4i)
+GLAD_FUNCTION(glVertexAttribI1ui)
+GLAD_FUNCTION(glVertexAttribI2ui)
+GLAD_FUNCTION(glVertexAttribI3ui)
+GLAD_FUNCTION(glVertexAttribI4ui)
+GLAD_FUNCTION(glVertexAttribI1iv)
+GLAD_FUNCTION(glVertexAttribI2iv)
+GLAD_FUNCTION(glVertexAttribI3iv)
+GLAD_FUNCTION(glVertexAttribI4iv)
+GLAD_FUNCTION(glVertexAttribI1uiv)
+GLAD_FUNCTION(glVertexAttribI2uiv)
+GLAD_FUNCTION(glVertexAttribI3uiv)
+GLAD_FUNCTION(glVertexAttribI4uiv)
+GLAD_FUNCTION(glVertexAttribI4bv)
+GLAD_FUNCTION(glVertexAttribI4sv)
+GLAD_FUNCTION(glVertexAttribI4ubv)
+GLAD_FUNCTION(glVertexAttribI4usv)
+GLAD_FUNCTION(glGetUniformuiv)
+GLAD_FUNCTION(glBindFragDataLocation)
+GLAD_FUNCTION(glGetFragDataLocation)
+GLAD_FUNCTION(glUniform1ui)
+GLAD_FUNCTION(glUniform2ui)
+GLAD_FUNCTION(glUniform3ui)
+GLAD_FUNCTION(glUniform4ui)
+GLAD_FUNCTION(glUniform1uiv)
+GLAD_FUNCTION(glUniform2uiv)
+GLAD_FUNCTION(glUniform3uiv)
+GLAD_FUNCTION(glUniform4uiv)
+GLAD_FUNCTION(glTexParameterIiv)
+GLAD_FUNCTION(glTexParameterIuiv)
+GLAD_FUNCTION(glGetTexParameterIiv)
+GLAD_FUNCTION(glGetTexParameterIuiv)
+GLAD_FUNCTION(glClearBufferiv)
+GLAD_FUNCTION(glClearBufferuiv)
+GLAD_FUNCTION(glClearBufferfv)
+GLAD_FUNCTION(glClearBufferfi)
+GLAD_FUNCTION(glGetStringi)
+GLAD_FUNCTION(glIsRenderbuffer)
+GLAD_FUNCTION(glBindRenderbuffer)
+GLAD_FUNCTION(glDeleteRenderbuffers)
+GLAD_FUNCTION(glGenRenderbuffers)
+GLAD_FUNCTION(glRenderbufferStorage)
+GLAD_FUNCTION(glGetRenderbufferParameteriv)
+GLAD_FUNCTION(glIsFramebuffer)
+GLAD_FUNCTION(glBindFramebuffer)
+GLAD_FUNCTION(glDeleteFramebuffers)
+GLAD_FUNCTION(glGenFramebuffers)
+GLAD_FUNCTION(glCheckFramebufferStatus)
+GLAD_FUNCTION(glFramebufferTexture1D)
+GLAD_FUNCTION(glFramebufferTexture2D)
+GLAD_FUNCTION(glFramebufferTexture3D)
+GLAD_FUNCTION(glFramebufferRenderbuffer)
+GLAD_FUNCTION(glGetFramebufferAttachmentParameteriv)
+GLAD_FUNCTION(glGenerateMipmap)
+GLAD_FUNCTION(glBlitFramebuffer)
+GLAD_FUNCTION(glRenderbufferStorageMultisample)
+GLAD_FUNCTION(glFramebufferTextureLayer)
+GLAD_FUNCTION(glMapBufferRange)
+GLAD_FUNCTION(glFlushMappedBufferRange)
+GLAD_FUNCTION(glBindVertexArray)
+GLAD_FUNCTION(glDeleteVertexArrays)
+GLAD_FUNCTION(glGenVertexArrays)
+GLAD_FUNCTION(glIsVertexArray)
+GLAD_FUNCTION(glDrawArraysInstanced)
+GLAD_FUNCTION(glDrawElementsInstanced)
+GLAD_FUNCTION(glTexBuffer)
+GLAD_FUNCTION(glPrimitiveRestartIndex)
+GLAD_FUNCTION(glCopyBufferSubData)
+GLAD_FUNCTION(glGetUniformIndices)
+GLAD_FUNCTION(glGetActiveUniformsiv)
+GLAD_FUNCTION(glGetActiveUniformName)
+GLAD_FUNCTION(glGetUniformBlockIndex)
+GLAD_FUNCTION(glGetActiveUniformBlockiv)
+GLAD_FUNCTION(glGetActiveUniformBlockName)
+GLAD_FUNCTION(glUniformBlockBinding)
+GLAD_FUNCTION(glDrawElementsBaseVertex)
+GLAD_FUNCTION(glDrawRangeElementsBaseVertex)
+GLAD_FUNCTION(glDrawElementsInstancedBaseVertex)
+GLAD_FUNCTION(glMultiDrawElementsBaseVertex)
+GLAD_FUNCTION(glProvokingVertex)
+GLAD_FUNCTION(glFenceSync)
+GLAD_FUNCTION(glIsSync)
+GLAD_FUNCTION(glDeleteSync)
+GLAD_FUNCTION(glClientWaitSync)
+GLAD_FUNCTION(glWaitSync)
+GLAD_FUNCTION(glGetInteger64v)
+GLAD_FUNCTION(glGetSynciv)
+GLAD_FUNCTION(glGetInteger64i_v)
+GLAD_FUNCTION(glGetBufferParameteri64v)
+GLAD_FUNCTION(glFramebufferTexture)
+GLAD_FUNCTION(glTexImage2DMultisample)
+GLAD_FUNCTION(glTexImage3DMultisample)
+GLAD_FUNCTION(glGetMultisamplefv)
+GLAD_FUNCTION(glSampleMaski)
+GLAD_FUNCTION(glBindFragDataLocationIndexed)
+GLAD_FUNCTION(glGetFragDataIndex)
+GLAD_FUNCTION(glGenSamplers)
+GLAD_FUNCTION(glDeleteSamplers)
+GLAD_FUNCTION(glIsSampler)
+GLAD_FUNCTION(glBindSampler)
+GLAD_FUNCTION(glSamplerParameteri)
+GLAD_FUNCTION(glSamplerParameteriv)
+GLAD_FUNCTION(glSamplerParameterf)
+GLAD_FUNCTION(glSamplerParameterfv)
+GLAD_FUNCTION(glSamplerParameterIiv)
+GLAD_FUNCTION(glSamplerParameterIuiv)
+GLAD_FUNCTION(glGetSamplerParameteriv)
+GLAD_FUNCTION(glGetSamplerParameterIiv)
+GLAD_FUNCTION(glGetSamplerParameterfv)
+GLAD_FUNCTION(glGetSamplerParameterIuiv)
+GLAD_FUNCTION(glQueryCounter)
+GLAD_FUNCTION(glGetQueryObjecti64v)
+GLAD_FUNCTION(glGetQueryObjectui64v)
+GLAD_FUNCTION(glVertexAttribDivisor)
+GLAD_FUNCTION(glVertexAttribP1ui)
+GLAD_FUNCTION(glVertexAttribP1uiv)
+GLAD_FUNCTION(glVertexAttribP2ui)
+GLAD_FUNCTION(glVertexAttribP2uiv)
+GLAD_FUNCTION(glVertexAttribP3ui)
+GLAD_FUNCTION(glVertexAttribP3uiv)
+GLAD_FUNCTION(glVertexAttribP4ui)
+GLAD_FUNCTION(glVertexAttribP4uiv)
+GLAD_FUNCTION(glVertexP2ui)
+GLAD_FUNCTION(glVertexP2uiv)
+GLAD_FUNCTION(glVertexP3ui)
+GLAD_FUNCTION(glVertexP3uiv)
+GLAD_FUNCTION(glVertexP4ui)
+GLAD_FUNCTION(glVertexP4uiv)
+GLAD_FUNCTION(glTexCoordP1ui)
+GLAD_FUNCTION(glTexCoordP1uiv)
+GLAD_FUNCTION(glTexCoordP2ui)
+GLAD_FUNCTION(glTexCoordP2uiv)
+GLAD_FUNCTION(glTexCoordP3ui)
+GLAD_FUNCTION(glTexCoordP3uiv)
+GLAD_FUNCTION(glTexCoordP4ui)
+GLAD_FUNCTION(glTexCoordP4uiv)
+GLAD_FUNCTION(glMultiTexCoordP1ui)
+GLAD_FUNCTION(glMultiTexCoordP1uiv)
+GLAD_FUNCTION(glMultiTexCoordP2ui)
+GLAD_FUNCTION(glMultiTexCoordP2uiv)
+GLAD_FUNCTION(glMultiTexCoordP3ui)
+GLAD_FUNCTION(glMultiTexCoordP3uiv)
+GLAD_FUNCTION(glMultiTexCoordP4ui)
+GLAD_FUNCTION(glMultiTexCoordP4uiv)
+GLAD_FUNCTION(glNormalP3ui)
+GLAD_FUNCTION(glNormalP3uiv)
+GLAD_FUNCTION(glColorP3ui)
+GLAD_FUNCTION(glColorP3uiv)
+GLAD_FUNCTION(glColorP4ui)
+GLAD_FUNCTION(glColorP4uiv)
+GLAD_FUNCTION(glSecondaryColorP3ui)
+GLAD_FUNCTION(glSecondaryColorP3uiv)
+GLAD_FUNCTION(glMinSampleShading)
+GLAD_FUNCTION(glBlendEquationi)
+GLAD_FUNCTION(glBlendEquationSeparatei)
+GLAD_FUNCTION(glBlendFunci)
+GLAD_FUNCTION(glBlendFuncSeparatei)
+GLAD_FUNCTION(glDrawArraysIndirect)
+GLAD_FUNCTION(glDrawElementsIndirect)
+GLAD_FUNCTION(glUniform1d)
+GLAD_FUNCTION(glUniform2d)
+GLAD_FUNCTION(glUniform3d)
+GLAD_FUNCTION(glUniform4d)
+GLAD_FUNCTION(glUniform1dv)
+GLAD_FUNCTION(glUniform2dv)
+GLAD_FUNCTION(glUniform3dv)
+GLAD_FUNCTION(glUniform4dv)
+GLAD_FUNCTION(glUniformMatrix2dv)
+GLAD_FUNCTION(glUniformMatrix3dv)
+GLAD_FUNCTION(glUniformMatrix4dv)
+GLAD_FUNCTION(glUniformMatrix2x3dv)
+GLAD_FUNCTION(glUniformMatrix2x4dv)
+GLAD_FUNCTION(glUniformMatrix3x2dv)
+GLAD_FUNCTION(glUniformMatrix3x4dv)
+GLAD_FUNCTION(glUniformMatrix4x2dv)
+GLAD_FUNCTION(glUniformMatrix4x3dv)
+GLAD_FUNCTION(glGetUniformdv)
+GLAD_FUNCTION(glGetSubroutineUniformLocation)
+GLAD_FUNCTION(glGetSubroutineIndex)
+GLAD_FUNCTION(glGetActiveSubroutineUniformiv)
+GLAD_FUNCTION(glGetActiveSubroutineUniformName)
+GLAD_FUNCTION(glGetActiveSubroutineName)
+GLAD_FUNCTION(glUniformSubroutinesuiv)
+GLAD_FUNCTION(glGetUniformSubroutineuiv)
+GLAD_FUNCTION(glGetProgramStageiv)
+GLAD_FUNCTION(glPatchParameteri)
+GLAD_FUNCTION(glPatchParameterfv)
+GLAD_FUNCTION(glBindTransformFeedback)
+GLAD_FUNCTION(glDeleteTransformFeedbacks)
+GLAD_FUNCTION(glGenTransformFeedbacks)
+GLAD_FUNCTION(glIsTransformFeedback)
+GLAD_FUNCTION(glPauseTransformFeedback)
+GLAD_FUNCTION(glResumeTransformFeedback)
+GLAD_FUNCTION(glDrawTransformFeedback)
+GLAD_FUNCTION(glDrawTransformFeedbackStream)
+GLAD_FUNCTION(glBeginQueryIndexed)
+GLAD_FUNCTION(glEndQueryIndexed)
+GLAD_FUNCTION(glGetQueryIndexediv)
+GLAD_FUNCTION(glReleaseShaderCompiler)
+GLAD_FUNCTION(glShaderBinary)
+GLAD_FUNCTION(glGetShaderPrecisionFormat)
+GLAD_FUNCTION(glDepthRangef)
+GLAD_FUNCTION(glClearDepthf)
+GLAD_FUNCTION(glGetProgramBinary)
+GLAD_FUNCTION(glProgramBinary)
+GLAD_FUNCTION(glProgramParameteri)
+GLAD_FUNCTION(glUseProgramStages)
+GLAD_FUNCTION(glActiveShaderProgram)
+GLAD_FUNCTION(glCreateShaderProgramv)
+GLAD_FUNCTION(glBindProgramPipeline)
+GLAD_FUNCTION(glDeleteProgramPipelines)
+GLAD_FUNCTION(glGenProgramPipelines)
+GLAD_FUNCTION(glIsProgramPipeline)
+GLAD_FUNCTION(glGetProgramPipelineiv)
+GLAD_FUNCTION(glProgramUniform1i)
+GLAD_FUNCTION(glProgramUniform1iv)
+GLAD_FUNCTION(glProgramUniform1f)
+GLAD_FUNCTION(glProgramUniform1fv)
+GLAD_FUNCTION(glProgramUniform1d)
+GLAD_FUNCTION(glProgramUniform1dv)
+GLAD_FUNCTION(glProgramUniform1ui)
+GLAD_FUNCTION(glProgramUniform1uiv)
+GLAD_FUNCTION(glProgramUniform2i)
+GLAD_FUNCTION(glProgramUniform2iv)
+GLAD_FUNCTION(glProgramUniform2f)
+GLAD_FUNCTION(glProgramUniform2fv)
+GLAD_FUNCTION(glProgramUniform2d)
+GLAD_FUNCTION(glProgramUniform2dv)
+GLAD_FUNCTION(glProgramUniform2ui)
+GLAD_FUNCTION(glProgramUniform2uiv)
+GLAD_FUNCTION(glProgramUniform3i)
+GLAD_FUNCTION(glProgramUniform3iv)
+GLAD_FUNCTION(glProgramUniform3f)
+GLAD_FUNCTION(glProgramUniform3fv)
+GLAD_FUNCTION(glProgramUniform3d)
+GLAD_FUNCTION(glProgramUniform3dv)
+GLAD_FUNCTION(glProgramUniform3ui)
+GLAD_FUNCTION(glProgramUniform3uiv)
+GLAD_FUNCTION(glProgramUniform4i)
+GLAD_FUNCTION(glProgramUniform4iv)
+GLAD_FUNCTION(glProgramUniform4f)
+GLAD_FUNCTION(glProgramUniform4fv)
+GLAD_FUNCTION(glProgramUniform4d)
+GLAD_FUNCTION(glProgramUniform4dv)
+GLAD_FUNCTION(glProgramUniform4ui)
+GLAD_FUNCTION(glProgramUniform4uiv)
+GLAD_FUNCTION(glProgramUniformMatrix2fv)
+GLAD_FUNCTION(glProgramUniformMatrix3fv)
+GLAD_FUNCTION(glProgramUniformMatrix4fv)
+GLAD_FUNCTION(glProgramUniformMatrix2dv)
+GLAD_FUNCTION(glProgramUniformMatrix3dv)
+GLAD_FUNCTION(glProgramUniformMatrix4dv)
+GLAD_FUNCTION(glProgramUniformMatrix2x3fv)
+GLAD_FUNCTION(glProgramUniformMatrix3x2fv)
+GLAD_FUNCTION(glProgramUniformMatrix2x4fv)
+GLAD_FUNCTION(glProgramUniformMatrix4x2fv)
+GLAD_FUNCTION(glProgramUniformMatrix3x4fv)
+GLAD_FUNCTION(glProgramUniformMatrix4x3fv)
+GLAD_FUNCTION(glProgramUniformMatrix2x3dv)
+GLAD_FUNCTION(glProgramUniformMatrix3x2dv)
+GLAD_FUNCTION(glProgramUniformMatrix2x4dv)
+GLAD_FUNCTION(glProgramUniformMatrix4x2dv)
+GLAD_FUNCTION(glProgramUniformMatrix3x4dv)
+GLAD_FUNCTION(glProgramUniformMatrix4x3dv)
+GLAD_FUNCTION(glValidateProgramPipeline)
+GLAD_FUNCTION(glGetProgramPipelineInfoLog)
+GLAD_FUNCTION(glVertexAttribL1d)
+GLAD_FUNCTION(glVertexAttribL2d)
+GLAD_FUNCTION(glVertexAttribL3d)
+GLAD_FUNCTION(glVertexAttribL4d)
+GLAD_FUNCTION(glVertexAttribL1dv)
+GLAD_FUNCTION(glVertexAttribL2dv)
+GLAD_FUNCTION(glVertexAttribL3dv)
+GLAD_FUNCTION(glVertexAttribL4dv)
+GLAD_FUNCTION(glVertexAttribLPointer)
+GLAD_FUNCTION(glGetVertexAttribLdv)
+GLAD_FUNCTION(glViewportArrayv)
+GLAD_FUNCTION(glViewportIndexedf)
+GLAD_FUNCTION(glViewportIndexedfv)
+GLAD_FUNCTION(glScissorArrayv)
+GLAD_FUNCTION(glScissorIndexed)
+GLAD_FUNCTION(glScissorIndexedv)
+GLAD_FUNCTION(glDepthRangeArrayv)
+GLAD_FUNCTION(glDepthRangeIndexed)
+GLAD_FUNCTION(glGetFloati_v)
+GLAD_FUNCTION(glGetDoublei_v)
+GLAD_FUNCTION(glDrawArraysInstancedBaseInstance)
+GLAD_FUNCTION(glDrawElementsInstancedBaseInstance)
+GLAD_FUNCTION(glDrawElementsInstancedBaseVertexBaseInstance)
+GLAD_FUNCTION(glGetInternalformativ)
+GLAD_FUNCTION(glGetActiveAtomicCounterBufferiv)
+GLAD_FUNCTION(glBindImageTexture)
+GLAD_FUNCTION(glMemoryBarrier)
+GLAD_FUNCTION(glTexStorage1D)
+GLAD_FUNCTION(glTexStorage2D)
+GLAD_FUNCTION(glTexStorage3D)
+GLAD_FUNCTION(glDrawTransformFeedbackInstanced)
+GLAD_FUNCTION(glDrawTransformFeedbackStreamInstanced)
+GLAD_FUNCTION(glClearBufferData)
+GLAD_FUNCTION(glClearBufferSubData)
+GLAD_FUNCTION(glDispatchCompute)
+GLAD_FUNCTION(glDispatchComputeIndirect)
+GLAD_FUNCTION(glCopyImageSubData)
+GLAD_FUNCTION(glFramebufferParameteri)
+GLAD_FUNCTION(glGetFramebufferParameteriv)
+GLAD_FUNCTION(glGetInternalformati64v)
+GLAD_FUNCTION(glInvalidateTexSubImage)
+GLAD_FUNCTION(glInvalidateTexImage)
+GLAD_FUNCTION(glInvalidateBufferSubData)
+GLAD_FUNCTION(glInvalidateBufferData)
+GLAD_FUNCTION(glInvalidateFramebuffer)
+GLAD_FUNCTION(glInvalidateSubFramebuffer)
+GLAD_FUNCTION(glMultiDrawArraysIndirect)
+GLAD_FUNCTION(glMultiDrawElementsIndirect)
+GLAD_FUNCTION(glGetProgramInterfaceiv)
+GLAD_FUNCTION(glGetProgramResourceIndex)
+GLAD_FUNCTION(glGetProgramResourceName)
+GLAD_FUNCTION(glGetProgramResourceiv)
+GLAD_FUNCTION(glGetProgramResourceLocation)
+GLAD_FUNCTION(glGetProgramResourceLocationIndex)
+GLAD_FUNCTION(glShaderStorageBlockBinding)
+GLAD_FUNCTION(glTexBufferRange)
+GLAD_FUNCTION(glTexStorage2DMultisample)
+GLAD_FUNCTION(glTexStorage3DMultisample)
+GLAD_FUNCTION(glTextureView)
+GLAD_FUNCTION(glBindVertexBuffer)
+GLAD_FUNCTION(glVertexAttribFormat)
+GLAD_FUNCTION(glVertexAttribIFormat)
+GLAD_FUNCTION(glVertexAttribLFormat)
+GLAD_FUNCTION(glVertexAttribBinding)
+GLAD_FUNCTION(glVertexBindingDivisor)
+GLAD_FUNCTION(glDebugMessageControl)
+GLAD_FUNCTION(glDebugMessageInsert)
+GLAD_FUNCTION(glDebugMessageCallback)
+GLAD_FUNCTION(glGetDebugMessageLog)
+GLAD_FUNCTION(glPushDebugGroup)
+GLAD_FUNCTION(glPopDebugGroup)
+GLAD_FUNCTION(glObjectLabel)
+GLAD_FUNCTION(glGetObjectLabel)
+GLAD_FUNCTION(glObjectPtrLabel)
+GLAD_FUNCTION(glGetObjectPtrLabel)
+GLAD_FUNCTION(glGetPointerv)
+GLAD_FUNCTION(glBufferStorage)
+GLAD_FUNCTION(glClearTexImage)
+GLAD_FUNCTION(glClearTexSubImage)
+GLAD_FUNCTION(glBindBuffersBase)
+GLAD_FUNCTION(glBindBuffersRange)
+GLAD_FUNCTION(glBindTextures)
+GLAD_FUNCTION(glBindSamplers)
+GLAD_FUNCTION(glBindImageTextures)
+GLAD_FUNCTION(glBindVertexBuffers)
+GLAD_FUNCTION(glClipControl)
+GLAD_FUNCTION(glCreateTransformFeedbacks)
+GLAD_FUNCTION(glTransformFeedbackBufferBase)
+GLAD_FUNCTION(glTransformFeedbackBufferRange)
+GLAD_FUNCTION(glGetTransformFeedbackiv)
+GLAD_FUNCTION(glGetTransformFeedbacki_v)
+GLAD_FUNCTION(glGetTransformFeedbacki64_v)
+GLAD_FUNCTION(glCreateBuffers)
+GLAD_FUNCTION(glNamedBufferStorage)
+GLAD_FUNCTION(glNamedBufferData)
+GLAD_FUNCTION(glNamedBufferSubData)
+GLAD_FUNCTION(glCopyNamedBufferSubData)
+GLAD_FUNCTION(glClearNamedBufferData)
+GLAD_FUNCTION(glClearNamedBufferSubData)
+GLAD_FUNCTION(glMapNamedBuffer)
+GLAD_FUNCTION(glMapNamedBufferRange)
+GLAD_FUNCTION(glUnmapNamedBuffer)
+GLAD_FUNCTION(glFlushMappedNamedBufferRange)
+GLAD_FUNCTION(glGetNamedBufferParameteriv)
+GLAD_FUNCTION(glGetNamedBufferParameteri64v)
+GLAD_FUNCTION(glGetNamedBufferPointerv)
+GLAD_FUNCTION(glGetNamedBufferSubData)
+GLAD_FUNCTION(glCreateFramebuffers)
+GLAD_FUNCTION(glNamedFramebufferRenderbuffer)
+GLAD_FUNCTION(glNamedFramebufferParameteri)
+GLAD_FUNCTION(glNamedFramebufferTexture)
+GLAD_FUNCTION(glNamedFramebufferTextureLayer)
+GLAD_FUNCTION(glNamedFramebufferDrawBuffer)
+GLAD_FUNCTION(glNamedFramebufferDrawBuffers)
+GLAD_FUNCTION(glNamedFramebufferReadBuffer)
+GLAD_FUNCTION(glInvalidateNamedFramebufferData)
+GLAD_FUNCTION(glInvalidateNamedFramebufferSubData)
+GLAD_FUNCTION(glClearNamedFramebufferiv)
+GLAD_FUNCTION(glClearNamedFramebufferuiv)
+GLAD_FUNCTION(glClearNamedFramebufferfv)
+GLAD_FUNCTION(glClearNamedFramebufferfi)
+GLAD_FUNCTION(glBlitNamedFramebuffer)
+GLAD_FUNCTION(glCheckNamedFramebufferStatus)
+GLAD_FUNCTION(glGetNamedFramebufferParameteriv)
+GLAD_FUNCTION(glGetNamedFramebufferAttachmentParameteriv)
+GLAD_FUNCTION(glCreateRenderbuffers)
+GLAD_FUNCTION(glNamedRenderbufferStorage)
+GLAD_FUNCTION(glNamedRenderbufferStorageMultisample)
+GLAD_FUNCTION(glGetNamedRenderbufferParameteriv)
+GLAD_FUNCTION(glCreateTextures)
+GLAD_FUNCTION(glTextureBuffer)
+GLAD_FUNCTION(glTextureBufferRange)
+GLAD_FUNCTION(glTextureStorage1D)
+GLAD_FUNCTION(glTextureStorage2D)
+GLAD_FUNCTION(glTextureStorage3D)
+GLAD_FUNCTION(glTextureStorage2DMultisample)
+GLAD_FUNCTION(glTextureStorage3DMultisample)
+GLAD_FUNCTION(glTextureSubImage1D)
+GLAD_FUNCTION(glTextureSubImage2D)
+GLAD_FUNCTION(glTextureSubImage3D)
+GLAD_FUNCTION(glCompressedTextureSubImage1D)
+GLAD_FUNCTION(glCompressedTextureSubImage2D)
+GLAD_FUNCTION(glCompressedTextureSubImage3D)
+GLAD_FUNCTION(glCopyTextureSubImage1D)
+GLAD_FUNCTION(glCopyTextureSubImage2D)
+GLAD_FUNCTION(glCopyTextureSubImage3D)
+GLAD_FUNCTION(glTextureParameterf)
+GLAD_FUNCTION(glTextureParameterfv)
+GLAD_FUNCTION(glTextureParameteri)
+GLAD_FUNCTION(glTextureParameterIiv)
+GLAD_FUNCTION(glTextureParameterIuiv)
+GLAD_FUNCTION(glTextureParameteriv)
+GLAD_FUNCTION(glGenerateTextureMipmap)
+GLAD_FUNCTION(glBindTextureUnit)
+GLAD_FUNCTION(glGetTextureImage)
+GLAD_FUNCTION(glGetCompressedTextureImage)
+GLAD_FUNCTION(glGetTextureLevelParameterfv)
+GLAD_FUNCTION(glGetTextureLevelParameteriv)
+GLAD_FUNCTION(glGetTextureParameterfv)
+GLAD_FUNCTION(glGetTextureParameterIiv)
+GLAD_FUNCTION(glGetTextureParameterIuiv)
+GLAD_FUNCTION(glGetTextureParameteriv)
+GLAD_FUNCTION(glCreateVertexArrays)
+GLAD_FUNCTION(glDisableVertexArrayAttrib)
+GLAD_FUNCTION(glEnableVertexArrayAttrib)
+GLAD_FUNCTION(glVertexArrayElementBuffer)
+GLAD_FUNCTION(glVertexArrayVertexBuffer)
+GLAD_FUNCTION(glVertexArrayVertexBuffers)
+GLAD_FUNCTION(glVertexArrayAttribBinding)
+GLAD_FUNCTION(glVertexArrayAttribFormat)
+GLAD_FUNCTION(glVertexArrayAttribIFormat)
+GLAD_FUNCTION(glVertexArrayAttribLFormat)
+GLAD_FUNCTION(glVertexArrayBindingDivisor)
+GLAD_FUNCTION(glGetVertexArrayiv)
+GLAD_FUNCTION(glGetVertexArrayIndexediv)
+GLAD_FUNCTION(glGetVertexArrayIndexed64iv)
+GLAD_FUNCTION(glCreateSamplers)
+GLAD_FUNCTION(glCreateProgramPipelines)
+GLAD_FUNCTION(glCreateQueries)
+GLAD_FUNCTION(glGetQueryBufferObjecti64v)
+GLAD_FUNCTION(glGetQueryBufferObjectiv)
+GLAD_FUNCTION(glGetQueryBufferObjectui64v)
+GLAD_FUNCTION(glGetQueryBufferObjectuiv)
+GLAD_FUNCTION(glMemoryBarrierByRegion)
+GLAD_FUNCTION(glGetTextureSubImage)
+GLAD_FUNCTION(glGetCompressedTextureSubImage)
+GLAD_FUNCTION(glGetGraphicsResetStatus)
+GLAD_FUNCTION(glGetnCompressedTexImage)
+GLAD_FUNCTION(glGetnTexImage)
+GLAD_FUNCTION(glGetnUniformdv)
+GLAD_FUNCTION(glGetnUniformfv)
+GLAD_FUNCTION(glGetnUniformiv)
+GLAD_FUNCTION(glGetnUniformuiv)
+GLAD_FUNCTION(glReadnPixels)
+GLAD_FUNCTION(glGetnMapdv)
+GLAD_FUNCTION(glGetnMapfv)
+GLAD_FUNCTION(glGetnMapiv)
+GLAD_FUNCTION(glGetnPixelMapfv)
+GLAD_FUNCTION(glGetnPixelMapuiv)
+GLAD_FUNCTION(glGetnPixelMapusv)
+GLAD_FUNCTION(glGetnPolygonStipple)
+GLAD_FUNCTION(glGetnColorTable)
+GLAD_FUNCTION(glGetnConvolutionFilter)
+GLAD_FUNCTION(glGetnSeparableFilter)
+GLAD_FUNCTION(glGetnHistogram)
+GLAD_FUNCTION(glGetnMinmax)
+GLAD_FUNCTION(glTextureBarrier)